@@ -9,7 +9,7 @@
 	#define LAYOUT_API __declspec(dllimport)
 #endif
 
-#include "control.h"
+#include <typeinfo>
 
 namespace Layout
 {
@@ -23,6 +23,48 @@ namespace Layout
 			Vertical
 		};
 
+		/**
+		 * The built-in alignment modes. Controls using one of these are aligned
+		 * by a switch over the kind, without a Mode instance.
+		 */
+		enum Kind
+		{
+			KindCustom,
+			KindTopLeft,
+			KindResize,
+			KindFit,
+			KindBottomRight,
+			KindRelative,
+			KindRelativeResize,
+			KindTrack
+		};
+
+		class Mode;
+
+		/**
+		 * The alignment of a control in one dimension, held by value.
+		 * For the built-in kinds the update is dispatched statically to the
+		 * static apply() functions of the corresponding Mode class.
+		 * Only KindCustom refers to a Mode instance, which is owned by the control.
+		 */
+		struct LAYOUT_API Slot
+		{
+			Kind nKind;   /// The built-in kind, or KindCustom
+			int iParam;   /// The minimum size for KindResize, the tracks for KindTrack, see Track::param()
+			Mode* pMode;  /// The mode for KindCustom, NULL otherwise
+
+			Slot(Kind kind = KindTopLeft, int param = 0, Mode* mode = NULL) : nKind(kind), iParam(param), pMode(mode) {}
+
+			/// Enforces the alignment for the passed dimension.
+			void update( Control* pCtrl, Dimension nDim, CRect& rctResult ) const;
+
+			/// See Mode::getMinInsets().
+			void getMinInsets( Control const* pCtrl, Dimension nDim, CRect& insets ) const;
+
+			/// Creates a heap instance of the Mode this slot stands for.
+			Mode* createMode() const;
+		};
+
 		/**
 		 * Virtual Alignment Base class.
 		 * Derivatives must overload the update() function in order
@@ -33,6 +75,10 @@ namespace Layout
 		public:
 			virtual Mode* copy() = 0;
 
+			/// Delivers the slot for this mode. Built-in modes return their kind,
+			/// other modes a KindCustom slot referring to themselves.
+			virtual Slot getSlot() { return Slot(KindCustom, 0, this); }
+
 			/// Purely virtual update function
 			virtual void update( Control*, Dimension nDim, CRect& rctResult ) = 0;
 
@@ -40,6 +86,12 @@ namespace Layout
 			/// from the top (to bottom), from the bottom (to top), from the left (to right),
 			/// and from the right (to left) parent area edge.
 			virtual void getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, __out CRect& insets) { insets.SetRect(0, 0, 0, 0); }
+
+		protected:
+			/// Delivers aSlot for an exact built-in mode, and a custom slot for classes
+			/// derived from it, so their overloads are still called.
+			template<class TMode>
+			Slot builtInSlot(Slot const& aSlot) { return typeid(*this) == typeid(TMode) ? aSlot : Slot(KindCustom, 0, this); }
 		};
 
 		#define DECLARE_COPY(alignment) virtual Mode* copy(){ return new alignment(*this); }
@@ -52,8 +104,12 @@ namespace Layout
 		{
 		public:
 			DECLARE_COPY(TopLeft);
+			virtual Slot getSlot() { return builtInSlot<TopLeft>(Slot(KindTopLeft)); }
 			virtual void update( Control*, Dimension nDim, CRect& rctResult );
 			virtual void getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, CRect& insets);
+
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult );
+			static void minInsets( Control const* pCtrl, Dimension nDim, CRect& insets );
 		};
 
 		/**
@@ -62,11 +118,12 @@ namespace Layout
 		 */
 		class LAYOUT_API Resize : public Mode
 		{
+		public:
 			/// Default minimum size for a resizable control, 10px from both sides.
 			static const int iDefaultMinSize = 10 * 2;
 
-		public:
 			DECLARE_COPY(Resize);
+			virtual Slot getSlot() { return builtInSlot<Resize>(Slot(KindResize, m_iMinSize)); }
 			
 			/** Alternate ctor: allows for creating a resize alignment with a minimum size. */
 			Resize(int minSize) : m_iMinSize(minSize) {}
@@ -75,6 +132,9 @@ namespace Layout
 			virtual void update( Control*, Dimension nDim, CRect& rctResult );
 			virtual void getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, __out CRect& insets);
 
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult );
+			static void minInsets( Control const* pCtrl, Dimension nDim, CRect& insets, int iMinSize );
+
 		private:
 			int m_iMinSize;
 		};
@@ -87,7 +147,10 @@ namespace Layout
 		{
 		public:
 			DECLARE_COPY(Fit);
+			virtual Slot getSlot() { return builtInSlot<Fit>(Slot(KindFit)); }
 			virtual void update( Control*, Dimension nDim, CRect& rctResult );
+
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult );
 		};
 
 		/**
@@ -98,8 +161,12 @@ namespace Layout
 		{
 		public:
 			DECLARE_COPY(BottomRight);
+			virtual Slot getSlot() { return builtInSlot<BottomRight>(Slot(KindBottomRight)); }
 			virtual void update( Control*, Dimension nDim, CRect& rctResult );
 			virtual void getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, CRect& insets);
+
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult );
+			static void minInsets( Control const* pCtrl, Dimension nDim, CRect& insets );
 		};
 
 		/**
@@ -116,10 +183,81 @@ namespace Layout
 			DECLARE_COPY(Relative);
 			Relative(bool bResize);
 
+			virtual Slot getSlot() { return builtInSlot<Relative>(Slot(m_bResize ? KindRelativeResize : KindRelative)); }
 			virtual void update( Control*, Dimension nDim, CRect& rctResult );
+
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult, bool bResize );
+		};
+
+		/**
+		 * Relative alignment which scales the controls size as well.
+		 * Only needed as a tag for Policy, equals Relative(true).
+		 */
+		class LAYOUT_API RelativeResize : public Relative
+		{
+		public:
+			DECLARE_COPY(RelativeResize);
+			RelativeResize() : Relative(true) {}
+			virtual Slot getSlot() { return builtInSlot<RelativeResize>(Slot(KindRelativeResize)); }
+		};
+
+		/**
+		 * The control spans tracks of the grid of its area, see Tracks and Manager::setGrid().
+		 * Its edges are the edges of the tracks, which are sized once per pass for all controls of the area.
+		 * Without tracks in the dimension, the control behaves like TopLeft.
+		 */
+		class LAYOUT_API Track : public Mode
+		{
+		public:
+			DECLARE_COPY(Track);
+			Track(int iIndex, int iSpan = 1) : m_iParam(param(iIndex, iSpan)) {}
+
+			virtual Slot getSlot() { return builtInSlot<Track>(Slot(KindTrack, m_iParam)); }
+			virtual void update( Control*, Dimension nDim, CRect& rctResult );
+
+			/// The slot for the tracks iIndex to iIndex + iSpan - 1, e.g. for Manager::addControl().
+			static Slot slot(int iIndex, int iSpan = 1) { return Slot(KindTrack, param(iIndex, iSpan)); }
+
+			/// Packs the first track and the number of tracks into Slot::iParam, and back.
+			static int param(int iIndex, int iSpan) { return (iSpan << 16) | (iIndex & 0xFFFF); }
+			static int index(int iParam) { return iParam & 0xFFFF; }
+			static int span(int iParam) { return (iParam >> 16) & 0xFFFF; }
+
+			static void apply( Control const* pCtrl, Dimension nDim, CRect& rctResult, int iParam );
+
+		private:
+			int m_iParam;
+		};
+
+		/**
+		 * Maps a built-in Mode class to its slot at compile time.
+		 * Not defined for other classes, so Policy only accepts built-in modes.
+		 * Track refers to its tracks by index, it is passed as Track::slot() instead.
+		 */
+		template<class TMode> struct Traits;
+		template<> struct Traits<TopLeft> { static Slot slot() { return Slot(KindTopLeft); } };
+		template<> struct Traits<Resize> { static Slot slot() { return Slot(KindResize, Resize::iDefaultMinSize); } };
+		template<> struct Traits<Fit> { static Slot slot() { return Slot(KindFit); } };
+		template<> struct Traits<BottomRight> { static Slot slot() { return Slot(KindBottomRight); } };
+		template<> struct Traits<Relative> { static Slot slot() { return Slot(KindRelative); } };
+		template<> struct Traits<RelativeResize> { static Slot slot() { return Slot(KindRelativeResize); } };
+
+		/**
+		 * Compile-time alignment combination of a horizontal and a vertical built-in mode,
+		 * e.g. Policy<Resize, TopLeft>(). Passed to Owner::setLayout() or Manager::addControl(),
+		 * the control is added without any Mode instance, heap copy or virtual call.
+		 */
+		template<class THorz, class TVert>
+		struct Policy
+		{
+			static Slot horz() { return Traits<THorz>::slot(); }
+			static Slot vert() { return Traits<TVert>::slot(); }
 		};
 	}
 }
 
 #undef DECLARE_COPY
+
+#include "control.h"
+
 #endif // _LAYOUT_ALIGNMENT_
\ No newline at end of file
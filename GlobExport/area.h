@@ -11,9 +11,12 @@
 
 #include <vector>
 
+#include <boost/cstdint.hpp>
+
 #include "splitter.h"
 #include "control.h"
 #include "areacreateparams.h"
+#include "tracks.h"
 
 class LayoutTest;
 
@@ -35,16 +38,22 @@ namespace Layout
 		LAYOUT_API Area(Manager const* pMgr, CRect const& rctFrame, SIZE const& hMinSize, SIZE const& hMaxSize);
 		virtual ~Area();
 
-		/** Inserts pControl into this alignment area's control list, if it is within the area.
-			Returns true, if the control has been inserted, false if otherwise.
-			Will propagate the insertion down to the last child area level. */
-		bool insertIfOwned(Control* pControl);
+		/** Inserts each control into the control list of the deepest area within this area that contains it,
+			in one descent of the area tree. The inserted controls are removed from vControls,
+			the controls which are not within this area remain. */
+		void insertOwned(__inout std::vector<Control*>& vControls);
+
+		/** Appends pControl to this areas control list and makes this area its alignment area. */
+		void attachControl(Control* pControl);
 
-		/** Remove an aligned control from this areas control list. Recurses the removal to the parent area.
+		/** Remove an aligned control from this areas control list.
 			Returns true if the control was found and removed.
 			This method will only remove the list entry, the pointer will stay intact. */
 		bool removeControl(Control* pCtrl);
 
+		/** Appends this area, or its descendants without children, to vLeafAreas. */
+		void getLeafAreas(__out std::vector<Area*>& vLeafAreas);
+
 		/** Resize the area. If the new shape is below the minimum size,
 		    so that the area collapses, newShape will be overwritten with the collapsed shape*/
 		void resizeAndAutoFoldIfNecessary(__inout CRect& newShape, __in bool bShapeIsScreenCoords = true);
@@ -56,21 +65,38 @@ namespace Layout
 			DOES NOT PERFORM ANY MIN SIZE ACCORDANCE VERIFICATION. */
 		void updateChildAreas();
 
-		/** Corrects the position of a given splitter rect according to the child areas minimum sizes.
-		    Returns true if the splitter rect was manipulated. */
-		bool checkSplitterRectWithChildAreaMinSizesAndAutoFold(__inout CRect& rctSplitter) const;
+		/** Corrects the position of a given rect of the splitter nSplitter according to the minimum sizes of
+		    the two child areas next to it. Returns true if the splitter rect was manipulated. */
+		bool checkSplitterRectWithChildAreaMinSizesAndAutoFold(__in size_t nSplitter, __inout CRect& rctSplitter) const;
+
+		/** Delivers the shapes of the two child areas next to the splitter nSplitter, if it was at the given rect.
+		    The other splitters are taken at their current position. */
+		void getChildAreaShapes(__in size_t nSplitter, __out CRect& rctHi, __out CRect& rctLo, __in CRect const& rctSplitter, __in bool bSplitterRectIsScreenCoords = false ) const;
 
-		/** Delivers the shapes of the child areas according to this areas splitters current position. */
-		void getChildAreaShapes(__out CRect& rctHi, __out CRect& rctLo ) const;
+		/** Delivers the current rect of the splitter nSplitter in screen coords. */
+		void getSplitterScreenRect(__in size_t nSplitter, __out CRect& rctSplitter) const;
 
-		/** Delivers the shapes of the child areas according to a given splitter rect. */
-		void getChildAreaShapes(__out CRect& rctHi, __out CRect& rctLo, __in CRect const& rctSplitter, __in bool bSplitterRectIsScreenCoords = false ) const;
+		/** Returns the position of a child area in m_vChildren, or the number of children if it is none of them. */
+		size_t getChildIndex(Area const* pChild) const;
+
+		/** Returns the orientation of the splitters of this parent area. */
+		Splitter::Orientation getSplitOrientation() const {return m_vSplitters.front()->getOrientation();}
 
 		/** Updates the control shapes according to theire alignments. */
 		void updateControls();
 
+		/** Adds the windows of the controls to the batch, or defers them in viewport mode. The controls must be aligned already. */
+		HDWP applyControls(HDWP windowPosHandle, CRect const& rctVisible);
+
+		/** Requests or returns the windows of the virtual controls of this area. Called after applyControls(). */
+		void updateVirtualControls(CRect const& rctVisible);
+
+		/** Invalidates the managed window below the given rect in layout coords. */
+		void invalidate(CRect const& rctLayout) const;
+
 		/** Update the areas actual minimum size. That is either the sum of the child areas minimum sizes,
-			or this areas minimum size, depending on which one is smaller. */
+			or this areas minimum size, depending on which one is smaller.
+			Only stale areas are recomputed, see invalidateMinSize(). */
 		void updateMinSize() const;
 
 		/** Returns, whether this area has a minimum size. */
@@ -82,6 +108,10 @@ namespace Layout
 		/** Updates m_rctOrigRect according to the current m_rctCurrentClientRect. */
 		void updateOrigRect();
 
+		/** Like updateOrigRect(), but limited to the layout state of this subtree: no window is read or moved.
+		    Used after splitter moves, which only change the shapes below the splitter's area. */
+		void rebaseOrigRect();
+
 		/** Updates the folded min size. Incorporates eventual differences between
 		    the visible client rect and the actual client rect for areas that touch
 		    the parent windows border. */
@@ -89,9 +119,20 @@ namespace Layout
 
 		/** Split the alignment area between two controls. They both must belong to this alignment area.
 			The splitter will  be put below/right to pHigh, and above/left to pLow, depending on the orientation of the splitter.
-			This works only if this alignment area doesn't already have a splitter. */
+			This works only if this alignment area doesn't already have a splitter.
+			If the parent is split in the same orientation, see canJoinParent(), the area becomes two children
+			of the parent instead of getting children of its own. */
 		Splitter const* putSplitter(Control const* pHigh, Control const* pLow, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
 
+		/** Returns whether a splitter at the given rect can be put into the parent instead of this area:
+			The parent is split in the same orientation, this area is a plain leaf without own min or max size,
+			styles, name or window, and none of its controls straddles the splitter. */
+		bool canJoinParent(Splitter::Orientation nOrientation, CRect const& rctSplitter) const;
+
+		/** Splits the child pChild by a new splitter at the given rect. pChild keeps the higher part,
+			a new child area after it gets the lower part and the controls within. */
+		Splitter const* splitChild(Area* pChild, CRect const& rctSplitter, Splitter::SplitterAlignment nAlignment);
+
 		/** Obtain a rectangle for a new splitter between pHigh and pLow  */
 		void getSplitterRect( Splitter::Orientation nOrientation, __out CRect& rctSplitter, Control const* pHigh, Control const* pLow );
 
@@ -113,9 +154,16 @@ namespace Layout
 		/** Manipulates the width or height of the given area shape to be folded on a given dimension */
 		void getFoldedShape( __in Splitter::Orientation nOrientation, __inout CRect& rctShape );
 
-		/** Creates a static background window for the area to establish the background color and area captioning. */
+		/** Creates a static window for the area. Areas are windowless unless they host a child layout. */
 		void CreateLayoutAreaWindow();
 
+		/** Switches to the hover colors and lets the manager report when the mouse leaves. */
+		void setHovered();
+
+		/** Sets the visibility of the area and its child areas, and marks their controls to be shown or hidden.
+		    The marked controls are appended to vControls, setVisible() applies them in one batch. */
+		void markVisible(bool bShow, __inout std::vector<Control*>& vControls);
+
 		/** Calls draw recursively on the children, or draws the text and
 		    the background color of the area if it does not have children. */
 		void draw( HDC hDC );
@@ -135,9 +183,21 @@ namespace Layout
 		    The method will only check the edges for which the input parameter value is one. */
 		void getTouchedParentWindowEdges(__inout bool& bTop, __inout bool& bBottom, __inout bool& bLeft, __inout bool& bRight) const;
 
-		/** If the designates HWND belongs to the background control of this area or
-		    any of this areas child areas, this function returns that area */
-		Area* isBackgroundHwnd(HWND hCtrl);
+		/** Derives the touched window edges and the hi/lo roles from the parent. Called when the area is created
+		    and again by putSplitter() and splitChild() for the new children, whose role is only known once they are assigned. */
+		void updateTopology();
+
+		/** Derives m_aiRelativeScale from the current and orig client rect. Called whenever one of them changes. */
+		void updateRelativeScale();
+
+		/** Replaces the tracks of a dimension. Areas with tracks are grids, see Manager::setGrid(). */
+		void setTracks(Align::Dimension nDim, Tracks const& aTracks);
+
+		/** Fits the auto tracks to the controls aligned with Align::Track, if they changed since the last call. */
+		void fitTracks() const;
+
+		/** Sizes the tracks for the current client rect. Called before the controls are aligned. */
+		void layoutTracks();
 
 	public:
 		/** Get the current size of the area */
@@ -155,6 +215,12 @@ namespace Layout
 		/** Get the current rect of the area in client coords. */
 		LAYOUT_API CRect const& getClientRect() const { return m_rctCurrentClientShape; }
 
+		/** Get the tracks of a dimension, as sized by the last pass. Empty if the area is no grid in that dimension. */
+		LAYOUT_API Tracks const& getTracks(Align::Dimension nDim) const { return m_aTracks[nDim]; }
+
+		/** Get the current client size divided by the orig one in 16.16 fixed point, for Align::Relative. */
+		LAYOUT_API boost::int32_t getRelativeScale(Align::Dimension nDim) const { return m_aiRelativeScale[nDim]; }
+
 		/** Update the shape of the area with a new user specified rect.
 		    The area will check to see if the new shape is smaller than the possible minimum. */
 		LAYOUT_API void update(__inout CRect rctNewrect);
@@ -172,38 +238,60 @@ namespace Layout
 			(That is, when its Top Left corner lies within the area) */
 		LAYOUT_API bool isControlInRect(Control const* pCtrl);
 
-		/** Returns whether this area is the parent area of two other areas */
+		/** Returns whether this area is the parent area of two or more other areas */
 		LAYOUT_API bool isParentArea() const;
 
-		/** Get the areas final minimum size. Updated in updateMinSize() */
+		/** Get the areas final minimum size. Recomputed by updateMinSize() first if it is stale. */
 		LAYOUT_API SIZE const& getMinSize() const;
 
+		/** Marks the min size of this area and its ancestors stale. Called when controls are added, removed,
+			shown, hidden or realigned and when the orig rects change. Recomputed before the next clamp or pass. */
+		LAYOUT_API void invalidateMinSize() const;
+
+		/** Returns whether the min size has to be recomputed. */
+		LAYOUT_API bool isMinSizeStale() const {return m_bMinSizeStale;}
+
 		/** Get the areas final minimum size. Updated in updateMinSize() */
 		LAYOUT_API SIZE const& getMaxSize() const;
 
-		/** Get the high child (Top/Left). Returns Null if this is not a parent area. */
-		LAYOUT_API Area const* getChildHi() const {return m_pHiChild;}
+		/** Get the highest child (Top/Left). Returns Null if this is not a parent area. */
+		LAYOUT_API Area const* getChildHi() const {return m_vChildren.empty() ? NULL : m_vChildren.front();}
+
+		/** Get the lowest child (Bottom/Right). Returns Null if this is not a parent area. */
+		LAYOUT_API Area const* getChildLo() const {return m_vChildren.empty() ? NULL : m_vChildren.back();}
 
-		/** Get the low child (Bottom/Right). Returns Null if this is not a parent area. */
-		LAYOUT_API Area const* getChildLo() const {return m_pLoChild;}
+		/** Get the number of child areas. 0 if this is not a parent area. */
+		LAYOUT_API size_t getChildCount() const {return m_vChildren.size();}
+
+		/** Get a child area, counted from the top/left. */
+		LAYOUT_API Area const* getChild(size_t nIndex) const {return m_vChildren[nIndex];}
 
 		/** Get the parent area. Returns Null if this is a child area. */
 		LAYOUT_API Area const* getParent() const {return m_pParent;}
 
-		/** Get the splitter of this Alignment Area. Returns Null if this is not a parent area. */
-		LAYOUT_API Splitter const* getSplitter() const {return m_pSplitter;}
+		/** Get the number of ancestors of this area. 0 for the main area. */
+		LAYOUT_API int getDepth() const {return m_pParent ? m_pParent->getDepth() + 1 : 0;}
+
+		/** Get the first splitter of this Alignment Area. Returns Null if this is not a parent area. */
+		LAYOUT_API Splitter const* getSplitter() const {return m_vSplitters.empty() ? NULL : m_vSplitters.front();}
+
+		/** Get the number of splitters, one less than the number of child areas. */
+		LAYOUT_API size_t getSplitterCount() const {return m_vSplitters.size();}
+
+		/** Get the splitter between the child areas nIndex and nIndex + 1. */
+		LAYOUT_API Splitter const* getSplitter(size_t nIndex) const {return m_vSplitters[nIndex];}
 
 		/** Returns which Background color style (normal or hover) is currently used by the area. */
 		LAYOUT_API AreaStyles getCurrentBkColorStyle() const;
 
-		/** Returns whether this area is the lower one of the parents child areas.*/
+		/** Returns whether this area is the lowest one of the parents child areas.*/
 		LAYOUT_API bool isLoArea() const;
 
 		/** Returns whether the first parent area whose parent is
 		    split by a splitter of the given orientation is the lower sibling.*/
 		LAYOUT_API bool isLoArea(Splitter::Orientation nOrientation) const;
 
-		/** Returns whether this area is the higher one of the parents child areas.*/
+		/** Returns whether this area is not the lowest one of the parents child areas.*/
 		LAYOUT_API bool isHiArea() const;
 
 		/** Returns whether the first parent area whose parent is
@@ -236,6 +324,7 @@ namespace Layout
 
 		/** Min Size Management */
 		SIZE m_hMinSize;      /// The areas user issued minimum size
+		mutable bool m_bMinSizeStale; /// m_hProcessedMinSize is out of date. If set, it is also set for all ancestors
 		mutable SIZE m_hProcessedMinSize; /// The windows processed min size (The result of the recursive minsize check done in getMinSize())
 		mutable SIZE m_hFoldedMinSize; /// The windows processed min size (The result of the recursive minsize check done in getMinSize())
 		mutable SIZE m_hProcessedFoldedMinSize; /// The windows processed min size (The result of the recursive minsize check done in getMinSize())
@@ -246,13 +335,29 @@ namespace Layout
 		bool m_bVisible;      /// Set in setVisible. Tells draw() to draw nothing if false.
 		mutable std::map<Splitter::Orientation, bool> m_mapDimensionFolded; /// Tells if the area is folded for a specific splitter orientaion
 
+		/** Topology, see updateTopology() */
+		enum Edge
+		{
+			EdgeTop    = 1,
+			EdgeBottom = 2,
+			EdgeLeft   = 4,
+			EdgeRight  = 8,
+			EdgeAll    = EdgeTop|EdgeBottom|EdgeLeft|EdgeRight
+		};
+		UINT m_nTouchedEdges; /// The Edge flags of the managed window's client rect this area touches
+		bool m_abHiArea[2];   /// isHiArea() per Splitter::Orientation
+		boost::int32_t m_aiRelativeScale[2]; /// getRelativeScale() per Align::Dimension
+
+		/** Grid management */
+		mutable Tracks m_aTracks[2];  /// getTracks() per Align::Dimension
+		mutable bool m_bTracksStale;  /// The auto tracks have to be fitted to the controls again, see fitTracks()
+
 		/** Associate pointers */
 		std::vector<Control*> m_vControls; /// The controls that fall into this area
 		Manager const* m_pAlignmentManager; /// The manager this area is maintained by
 		Area const* m_pParent; /// The parent area. Can be Null.
-		Area* m_pHiChild; /// The higher child area (Top/Left)
-		Area* m_pLoChild; /// The lower child area (Bottom/Right)
-		Splitter* m_pSplitter; /// The splitter of this Alignment Area. Null if this is not a parent area.
+		std::vector<Area*> m_vChildren; /// The child areas from Top/Left to Bottom/Right. Empty if this is not a parent area.
+		std::vector<Splitter*> m_vSplitters; /// m_vSplitters[i] lies between m_vChildren[i] and m_vChildren[i + 1]
 	};
 }
 
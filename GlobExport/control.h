@@ -5,6 +5,8 @@
 
 #include <map>
 
+#include "alignment.h"
+
 #ifdef LAYOUT_DLL_BUILD
 	#define LAYOUT_API __declspec(dllexport)
 #else
@@ -15,14 +17,28 @@ class LayoutTest;
 
 namespace Layout
 {
-	namespace Align
-	{
-		class Mode;
-	}
-	
 	class Manager;
 	class Area;
 	class Editor;
+	class Control;
+
+	/**
+	 * Implemented by the owner of virtual controls (see Manager::addVirtualControl()).
+	 * The manager requests a window for a virtual control when it enters the visible
+	 * client rect of the managed window, and hands it back when it leaves it again.
+	 */
+	class VirtualControlHost
+	{
+	public:
+		virtual ~VirtualControlHost() {}
+
+		/** Create the window for a virtual control at rctClient (client coords of the managed window).
+		    Return NULL to leave the control without a window. */
+		virtual HWND materialize(Control const* pCtrl, UINT_PTR nKey, CRect const& rctClient) = 0;
+
+		/** The virtual control left the visible client rect. The host may destroy or recycle hWnd. */
+		virtual void dematerialize(Control const* pCtrl, UINT_PTR nKey, HWND hWnd) = 0;
+	};
 
 	/**
 	 * Helper class, instanced for each control added to the Manager.
@@ -40,29 +56,68 @@ namespace Layout
 		static LRESULT CALLBACK EditorWindowProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
 		static LRESULT CALLBACK NormalWindowProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
 		
-		HWND m_hID;                        /// The window handle of the represented CWnd
+		HWND m_hID;                        /// The window handle of the represented CWnd. NULL for a virtual control without window.
 		CRect m_rctOrig;                   /// The control's rect when it was added to the manager
 		mutable CRect m_rctCurrent;        /// The control's current rect
-		mutable Align::Mode* m_pHorzAlign; /// The controls Horiz. Alignment Mode
-		mutable Align::Mode* m_pVertAlign; /// The controls Vert. Alignment Mode
+		mutable CRect m_rctApplied;        /// The rect the window was last seen at or moved to
+		mutable Align::Slot m_aHorzAlign;  /// The controls Horiz. Alignment, owns its Mode if any
+		mutable Align::Slot m_aVertAlign;  /// The controls Vert. Alignment, owns its Mode if any
 		Manager const* m_pManager;         /// The Alignment manager this instance belongs to
 		const Area* m_pAlignmentArea;      /// The Alignment Area this control belongs to
 		bool m_bVisibilityBeforeTempHide; /// Tells if the conrol was visible before temporaryHide was called
 		std::string m_sName; /// The unique string identifier of the control. Can currently be Null.
 		mutable WNDPROC m_pWndProc;
+		bool m_bVirtual;       /// True for controls without a permanent window. Their rects are pure geometry.
+		bool m_bVirtualHidden; /// The visibility of a virtual control, set by temporaryHide()/temporaryShow()
+		UINT_PTR m_nKey;       /// The host key of a virtual control
+		bool m_bLayoutPending; /// The aligned rect has not been applied to the window yet. See Manager::setViewportMode()
+		bool m_bShown;         /// The visibility the layout wants for the window. Read from GWL_STYLE once, then maintained by temporaryHide()/temporaryShow() and Manager::setControlVisible()
+		bool m_bShownApplied;  /// The visibility the window was last seen with or set to. apply() shows or hides the window if it differs from m_bShown
 		
 		/** CTor. Create a new Aligned Control instance for a specific manager and window pointer, with specific horizontal
 			and vertical alignments. */
 		LAYOUT_API Control( Manager const*, HWND hCtrl, Align::Mode&, Align::Mode&, std::string sName = "" );
+
+		/** CTor. Create a new Aligned Control instance with alignment slots. Only custom modes are copied. */
+		LAYOUT_API Control( Manager const*, HWND hCtrl, Align::Slot const&, Align::Slot const&, std::string sName = "" );
+
+		/** CTor. Same as above, with the window rect already read in layout coords. Used by Manager::addControls(). */
+		Control( Manager const*, HWND hCtrl, Align::Slot const&, Align::Slot const&, std::string sName, CRect const& rctWindow );
+		
+		/** CTor. Create a virtual control, which has no window until the VirtualControlHost materializes it. */
+		LAYOUT_API Control( Manager const*, UINT_PTR nKey, CRect const& rctOrig, Align::Slot const&, Align::Slot const&, std::string sName = "" );
+
+		/** Returns whether the control is currently shown. */
+		bool isShown() const;
+
+		/** Returns whether the control counts for the min size of its area, see getMinInsets(). */
+		bool countsForMinSize(bool bFolded) const {return bFolded ? m_bVisibilityBeforeTempHide : isShown();}
+
+		/** Reads the initial state of the represented window. Shared by the CTors.
+		    @param prctWindow [optional] The window rect in layout coords, read from the window if NULL. */
+		void initWindow(CRect const* prctWindow = NULL);
+
+		/** Drops what depends on the alignment of this control: the memoized layout passes and the min size of its area. */
+		void alignmentChanged();
+
+		/** Assigns aSource to aTarget. The target takes ownership of the mode, which is copied first if bCopyMode is set. */
+		static void assignSlot(Align::Slot& aTarget, Align::Slot const& aSource, bool bCopyMode);
+
+		/** Turns a built-in slot into a KindCustom slot with its own Mode, so that changes to the mode take effect. */
+		Align::Mode* customizeSlot(Align::Slot& aSlot);
 		
 		/** DTor. */
 		virtual ~Control();
 		
-		/** Hides the control temporarily and remembers if the control was shown before the temporaryHide() */
+		/** Hides the control temporarily and remembers if the control was shown before the temporaryHide().
+		    Only the state changes, the window is hidden by the next apply() or applyVisibility(). */
 		virtual void temporaryHide();
 		
-		/** Hides the control temporarily and remembers if the control was shown before the temporaryHide() */
+		/** Shows the control again, if it was shown before the temporaryHide(). Like temporaryHide(), the window follows later. */
 		virtual void temporaryShow();
+
+		/** Shows or hides the window as part of a DeferWindowPos batch, without moving it. Nothing is done if it is already in that state. */
+		HDWP applyVisibility(HDWP windowPosHandle);
 		
 		/** Called by the editor to install or uninstall the "editor mode" on the control */
 		virtual void installEditorWndProc(bool bInstall) const;
@@ -83,6 +138,15 @@ namespace Layout
 		/** Set the alignment area this control belongs to. */
 		LAYOUT_API void setAlignmentArea(Area const* pArea);
 
+		/** Returns whether this is a virtual control. See Manager::addVirtualControl(). */
+		LAYOUT_API bool isVirtual() const { return m_bVirtual; }
+
+		/** Returns the host key of a virtual control. */
+		LAYOUT_API UINT_PTR getKey() const { return m_nKey; }
+
+		/** Returns the window of the control. NULL for a virtual control that is not materialized. */
+		LAYOUT_API HWND getHwnd() const { return m_hID; }
+
 		/** Get a pointer to the control this Control instance has been created for. */
 		LAYOUT_API CWnd* getControl() const { return CWnd::FromHandle(m_hID); }
 
@@ -92,32 +156,55 @@ namespace Layout
 		/** Get the controls current screen rect */
 		LAYOUT_API void getScreenRect(CRect& rctResult) const;
 
-		/** Get this Control's horizontal alignment mode. */
-		LAYOUT_API Align::Mode* getHorzAlignment(){ return m_pHorzAlign; }
+		/** Get this Control's horizontal alignment mode. A built-in alignment gets a Mode instance on first request
+		    and is dispatched through it from then on, like a custom mode. Use getHorzSlot() to only read the alignment. */
+		LAYOUT_API Align::Mode* getHorzAlignment();
 
-		/** Get this Control's vertical alignment mode. */
-		LAYOUT_API Align::Mode* getVertAlignment(){ return m_pVertAlign; }
+		/** Get this Control's vertical alignment mode. See getHorzAlignment(). */
+		LAYOUT_API Align::Mode* getVertAlignment();
+
+		/** Get this Control's horizontal alignment slot. */
+		LAYOUT_API Align::Slot const& getHorzSlot() const { return m_aHorzAlign; }
+
+		/** Get this Control's vertical alignment slot. */
+		LAYOUT_API Align::Slot const& getVertSlot() const { return m_aVertAlign; }
 		
-		/** Get this Control's horizontal alignment mode. */
+		/** Set this Control's horizontal alignment mode. The control takes ownership of the mode. */
 		LAYOUT_API void setHorzAlignment( Align::Mode* pAlignHorz );
 
-		/** Get this Control's vertical alignment mode. */
+		/** Set this Control's vertical alignment mode. The control takes ownership of the mode. */
 		LAYOUT_API void setVertAlignment( Align::Mode* pAlignVert );
 
+		/** Set this Control's horizontal alignment slot. A custom mode is copied. */
+		LAYOUT_API void setHorzAlignment( Align::Slot const& aAlignHorz );
+
+		/** Set this Control's vertical alignment slot. A custom mode is copied. */
+		LAYOUT_API void setVertAlignment( Align::Slot const& aAlignVert );
+
 		/** Get this Control's window's current rect. */
 		LAYOUT_API CRect const& getRect() const;
 
 		/** Update (enforce) this Control's window's alignment according to the specified modes. */
 		LAYOUT_API virtual HDWP update(HDWP windowPosHandle);
+
+		/** Align the current rect according to the specified modes, without moving the window. */
+		LAYOUT_API void align();
+
+		/** Move the window to the current rect. Nothing is done if the window is already there. */
+		LAYOUT_API HDWP apply(HDWP windowPosHandle);
 		
 		/** Update this Control's orig rect to the current window rect of the window it represents */
 		LAYOUT_API void updateOrigRect();
+
+		/** Update this Control's orig rect to the rect the layout last placed it at, without reading the window. */
+		void rebaseOrigRect();
 		
 		/** Delivers the minimum amount of space necessary for the controls alignment,
 			from the top (to bottom), from the bottom (to top), from the left (to right),
 			and from the right (to left) parent area edge.
-			THE MINIMUM INSET WILL BE ANTICIPATED AS IRRELEVANT FOR INVISIBLE CONTROLS. */
-		LAYOUT_API void getMinInsets(__out CRect& insets) const;
+			THE MINIMUM INSET WILL BE ANTICIPATED AS IRRELEVANT FOR INVISIBLE CONTROLS.
+			@param bFolded Set for the controls of a folded area, they count if they were shown before the area folded. */
+		LAYOUT_API void getMinInsets(__out CRect& insets, bool bFolded = false) const;
 	}; // Control
 }
 
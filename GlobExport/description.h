@@ -0,0 +1,172 @@
+#ifndef _LAYOUT_DESCRIPTION_
+#define _LAYOUT_DESCRIPTION_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace Layout
+{
+	/**
+	 * Declarative description of a layout. A description names the controls of a window
+	 * together with their alignment modes, the splitters between them and the properties
+	 * of the areas the splitters create. Manager::applyDescription() compiles it into the
+	 * Area/Splitter/Control tree.
+	 *
+	 * The description only depends on the standard library, so it can be parsed,
+	 * serialized and verified without any window.
+	 *
+	 * Text format (one statement per line, '#' starts a comment):
+	 *
+	 *   control <name> <id> <horz> <vert>
+	 *       <horz>/<vert>: topleft | resize[:<minsize>] | fit | bottomright | relative | relative-resize
+	 *   splitter <highName> <lowName> horizontal|vertical high|low|relative
+	 *   area <controlName> [foldable] [leftline] [title="<caption>"]
+	 *                      [background=#RRGGBB] [hover=#RRGGBB] [text=#RRGGBB] [hovertext=#RRGGBB]
+	 *
+	 * An area statement describes the area which is limited by the named control
+	 * towards its splitter, just like AreaProperties::setControl().
+	 *
+	 * Both the text parser and loadBinary() produce the same flat image. The image
+	 * is what toBinary() writes, so a pre-compiled description is loaded by
+	 * validating the header and pointing into the buffer, without any parsing.
+	 */
+	class LAYOUT_API Description
+	{
+	public:
+		/** Alignment modes. Mirror the built-in Align::Mode implementations. */
+		enum AlignKind
+		{
+			AlignTopLeft,
+			AlignResize,
+			AlignFit,
+			AlignBottomRight,
+			AlignRelative,
+			AlignRelativeResize
+		};
+
+		/** Splitter orientations. Same values as Splitter::Orientation. */
+		enum SplitOrientation
+		{
+			SplitHorizontal,
+			SplitVertical
+		};
+
+		/** Splitter alignments. Same values as Splitter::SplitterAlignment. */
+		enum SplitAlignment
+		{
+			SplitAlignHigh,
+			SplitAlignLow,
+			SplitAlignRelative
+		};
+
+		/** Area style bits. Same values as Layout::AreaStyles. */
+		enum AreaStyleBits
+		{
+			StyleFoldable = 1,
+			StyleDrawBk = 2,
+			StyleDrawTitle = 4,
+			StyleHover = 8,
+			StyleHoverTitle = 16,
+			StyleDrawLeftLine = 32
+		};
+
+		/** A control statement. Names are offsets into the string table. */
+		struct ControlEntry
+		{
+			boost::uint32_t nId;      /// The dialog item id of the control
+			boost::uint32_t nName;    /// String table offset of the control name
+			boost::uint16_t nHorz;    /// Horizontal AlignKind
+			boost::uint16_t nVert;    /// Vertical AlignKind
+			boost::uint16_t nHorzMin; /// Minimum size of a horizontal AlignResize, 0 for the default
+			boost::uint16_t nVertMin; /// Minimum size of a vertical AlignResize, 0 for the default
+		};
+
+		/** A splitter statement. Controls are indices into the control table. */
+		struct SplitterEntry
+		{
+			boost::uint32_t nHigh;        /// Index of the control above/left of the splitter
+			boost::uint32_t nLow;         /// Index of the control below/right of the splitter
+			boost::uint16_t nOrientation; /// SplitOrientation
+			boost::uint16_t nAlignment;   /// SplitAlignment
+		};
+
+		/** An area statement. The control is an index into the control table. */
+		struct AreaEntry
+		{
+			boost::uint32_t nControl;   /// Index of the control limiting the area towards its splitter
+			boost::uint32_t nTitle;     /// String table offset of the caption
+			boost::uint32_t nStyle;     /// Combination of AreaStyleBits
+			boost::uint32_t crBk;       /// Background color (COLORREF layout)
+			boost::uint32_t crHover;    /// Hover background color
+			boost::uint32_t crText;     /// Title color
+			boost::uint32_t crHoverText;/// Hover title color
+		};
+
+		Description();
+		Description(Description const& aOther);
+		Description& operator=(Description const& aOther);
+
+		/**
+		 * Parse a description in text format.
+		 * @param pchText The zero terminated description text.
+		 * @param psError [optional] Receives "line <n>: <reason>" if parsing fails.
+		 * @return True, if the text was parsed. The description is left empty on failure.
+		 */
+		bool parse(char const* pchText, std::string* psError = NULL);
+
+		/**
+		 * Load a pre-compiled description written by toBinary(). Only the header is
+		 * validated, the tables are used in place.
+		 * @param bCopy If false, the buffer must outlive this description. A buffer which is not
+		 *        4 byte aligned is copied anyway.
+		 * @return True, if the buffer holds a valid image.
+		 */
+		bool loadBinary(void const* pData, size_t nSize, bool bCopy = true);
+
+		/** Delivers the pre-compiled image of this description. */
+		void toBinary(std::vector<char>& vResult) const;
+
+		/** Clears all statements. */
+		void clear();
+
+		/** Table accessors. */
+		size_t getControlCount() const {return m_nControls;}
+		size_t getSplitterCount() const {return m_nSplitters;}
+		size_t getAreaCount() const {return m_nAreas;}
+		ControlEntry const& getControl(size_t nIndex) const {return m_pControls[nIndex];}
+		SplitterEntry const& getSplitter(size_t nIndex) const {return m_pSplitters[nIndex];}
+		AreaEntry const& getArea(size_t nIndex) const {return m_pAreas[nIndex];}
+
+		/** Resolves a string table offset. */
+		char const* getString(boost::uint32_t nOffset) const {return m_pStrings + nOffset;}
+
+		/** Returns the index of the named control, or getControlCount() if there is none. */
+		size_t findControl(char const* pchName) const;
+
+	private:
+		/** Points the table members into the image at pData. */
+		bool attach(char const* pData, size_t nSize);
+
+		std::vector<char> m_vImage;  /// The owned image, empty if an external buffer is used
+		size_t m_nControls;
+		size_t m_nSplitters;
+		size_t m_nAreas;
+		ControlEntry const* m_pControls;
+		SplitterEntry const* m_pSplitters;
+		AreaEntry const* m_pAreas;
+		char const* m_pStrings;
+		size_t m_nStringBytes;
+	};
+}
+
+#endif // _LAYOUT_DESCRIPTION_
@@ -62,6 +62,8 @@ namespace Layout
 		int              m_iCliRctDX;         /// Tells how much smaller the client rect is than the window rect (X)
 		int              m_iCliRctDY;         /// Tells how much smaller the client rect is than the window rect (Y)
 		POINT            m_ptScrollPos;       /// The current horz and vert scrolling positions
+		CSize            m_hScrollRange;      /// The scroll ranges last passed to SetScrollInfo
+		CSize            m_hScrollPage;       /// The scroll page sizes last passed to SetScrollInfo
 		
 		/**
 		 * Helper function called in OnMove and OnSize
@@ -73,6 +75,11 @@ namespace Layout
 		 */
 		void updateScrollbars(int, int);
 		
+		/**
+		 * Helper function called in OnHScroll and OnVScroll
+		 */
+		void scrollTo(POINT ptPos);
+		
 		/**
 		 * Helper function to extract a filename from a Path. E.g. C:\foo.bar would deliver foo
 		 */
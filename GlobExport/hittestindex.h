@@ -0,0 +1,85 @@
+#ifndef _LAYOUT_HITTESTINDEX_
+#define _LAYOUT_HITTESTINDEX_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <map>
+#include <vector>
+
+namespace Layout
+{
+	class Area;
+	class Control;
+	class Splitter;
+	template<class TValue> class SpatialIndex;
+
+	/**
+	 * The rects of the leaf areas, splitters and controls of a manager in layout coords.
+	 * The layout pass updates an element whenever its rect changes, which is a remove and
+	 * an insert in O(log n), so the index never has to be rebuilt. Queries apply the exact
+	 * CRect semantics, i.e. the right and bottom edges are not part of a rect.
+	 */
+	class LAYOUT_API HitTestIndex
+	{
+	public:
+		enum Kind
+		{
+			KindArea,     /// A leaf area. Parent areas are covered by their children and splitter
+			KindSplitter,
+			KindControl
+		};
+
+		/** An indexed element. */
+		struct Element
+		{
+			Kind nKind;
+			Area* pArea;       /// Set for KindArea
+			Control* pControl; /// Set for KindSplitter and KindControl
+
+			Element() : nKind(KindArea), pArea(NULL), pControl(NULL) {}
+			Element(Area* pArea) : nKind(KindArea), pArea(pArea), pControl(NULL) {}
+			Element(Kind nKind, Control* pControl) : nKind(nKind), pArea(NULL), pControl(pControl) {}
+
+			Splitter* getSplitter() const;
+
+			bool operator==(Element const& rhs) const {return nKind == rhs.nKind && pArea == rhs.pArea && pControl == rhs.pControl;}
+			bool operator<(Element const& rhs) const;
+		};
+
+		HitTestIndex();
+		~HitTestIndex();
+
+		/** Indexes the element with the given rect, or moves it there. An empty rect removes the element. */
+		void update(Element const& aElement, CRect const& rctLayout);
+
+		/** Removes the element, if it is indexed. */
+		void remove(Element const& aElement);
+
+		/** Delivers the elements whose rect contains the point. */
+		void queryPoint(POINT ptLayout, std::vector<Element>& vResult) const;
+
+		/** Delivers the elements whose rect intersects rctLayout. */
+		void queryIntersecting(CRect const& rctLayout, std::vector<Element>& vResult) const;
+
+		/** Delivers the elements whose rect contains rctLayout. */
+		void queryContaining(CRect const& rctLayout, std::vector<Element>& vResult) const;
+
+		/** Returns the number of indexed elements. */
+		size_t size() const {return m_mapRects.size();}
+
+	private:
+		HitTestIndex(HitTestIndex const&);
+		HitTestIndex& operator=(HitTestIndex const&);
+
+		SpatialIndex<Element>* m_pIndex; /// Keeps the rtree out of this header
+		std::map<Element, CRect> m_mapRects; /// The rect each element is indexed with, needed to remove it
+	};
+}
+
+#endif // _LAYOUT_HITTESTINDEX_
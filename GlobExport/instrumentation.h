@@ -0,0 +1,151 @@
+#ifndef _LAYOUT_INSTRUMENTATION_
+#define _LAYOUT_INSTRUMENTATION_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace Layout
+{
+	/**
+	 * Latency statistics of the layout phases, shared by all managers with the same layout identifier.
+	 * The phases are only timed if the library is built with LAYOUT_INSTRUMENTATION defined,
+	 * otherwise the stats stay empty and the timing macros expand to nothing.
+	 */
+	class LAYOUT_API LayoutStats
+	{
+	public:
+		/** The timed phases. Each phase is measured exclusive of the phases nested in it. */
+		enum Phase
+		{
+			PhaseUpdate,     /// Manager::update() itself, i.e. the time not spent in any other phase
+			PhaseMinSize,    /// Area::updateMinSize()
+			PhaseSplitter,   /// Area::updateSplitter()
+			PhaseAlign,      /// Control::align()
+			PhaseApply,      /// Control::apply() and EndDeferWindowPos()
+			PhaseInvalidate, /// Background invalidation and orig rect rebasing
+			PhaseDraw,       /// Manager::draw()
+			PhaseCount
+		};
+
+		/** Histogram of durations with power of two buckets. Bucket 0 holds samples below 1us, bucket n those below 2^n us. */
+		struct Histogram
+		{
+			enum { BucketCount = 32 };
+
+			unsigned int aBuckets[BucketCount];
+			unsigned int nCount;
+			double dTotalUs;
+			double dMaxUs;
+
+			Histogram();
+
+			/** Adds a sample. */
+			void add(double dUs);
+
+			/** Returns the upper bound of the bucket holding the given fraction of samples, e.g. 0.99 for p99. Never more than the max. */
+			double percentile(double dFraction) const;
+		};
+
+		LayoutStats(std::string const& sIdentifier);
+
+		/** Returns the layout identifier of the managers sharing these stats. */
+		std::string const& getIdentifier() const {return m_sIdentifier;}
+
+		/** Returns the histogram of the durations of a phase within a pass. */
+		Histogram const& getHistogram(Phase nPhase) const {return m_aPhases[nPhase];}
+
+		/** Returns the histogram of the durations of whole passes. */
+		Histogram const& getPassHistogram() const {return m_aPass;}
+
+		/** Records the phase durations of one pass. Phases which were not entered are left out. */
+		void addPass(double const* pdPhaseUs, bool const* pbPhaseEntered);
+
+		/** Clears all histograms. */
+		void reset();
+
+		/** Appends the stats as a JSON object. */
+		void toJson(std::string& sResult) const;
+
+		/** Returns the name of a phase as used in the JSON output. */
+		static char const* getPhaseName(Phase nPhase);
+
+		/** Returns the stats for a layout identifier, creating them on first request. They live until the library is unloaded. */
+		static LayoutStats* forIdentifier(std::string const& sIdentifier);
+
+		/** Appends the stats of all layout identifiers as a JSON array. */
+		static void dumpAllJson(std::string& sResult);
+
+	private:
+		std::string m_sIdentifier;
+		Histogram m_aPhases[PhaseCount];
+		Histogram m_aPass;
+	};
+
+	/**
+	 * Measures the phases of the passes of one manager. Nested phases are subtracted from the
+	 * enclosing one, so the phase durations of a pass add up to the duration of the pass.
+	 */
+	class LAYOUT_API PhaseClock
+	{
+	public:
+		PhaseClock(LayoutStats* pStats);
+
+		/** Starts a phase. The current phase is paused until leave() is called. */
+		void enter(LayoutStats::Phase nPhase);
+
+		/** Ends the current phase and resumes the enclosing one. */
+		void leave();
+
+		/** Hands the durations of the pass to the stats, if no phase is running anymore. */
+		void endPass();
+
+		/** Returns the stats the passes are recorded to. */
+		LayoutStats const& getStats() const {return *m_pStats;}
+
+	private:
+		/** Credits the time since the last clock event to the current phase. */
+		void creditCurrent(boost::int64_t nNow);
+
+		LayoutStats* m_pStats;
+		std::vector<LayoutStats::Phase> m_vStack; /// The running phases, innermost last
+		boost::int64_t m_nLastTick;                        /// Time of the last enter() or leave()
+		boost::int64_t m_aPhaseTicks[LayoutStats::PhaseCount];
+		bool m_aPhaseEntered[LayoutStats::PhaseCount];
+	};
+
+	/** Times the enclosing scope as a phase of a PhaseClock. */
+	class ScopedPhase
+	{
+	public:
+		ScopedPhase(PhaseClock* pClock, LayoutStats::Phase nPhase) : m_pClock(pClock) { if(m_pClock) m_pClock->enter(nPhase); }
+		~ScopedPhase() { if(m_pClock) m_pClock->leave(); }
+
+	private:
+		PhaseClock* m_pClock;
+	};
+}
+
+#define LAYOUT_PHASE_CONCAT_(a, b) a##b
+#define LAYOUT_PHASE_CONCAT(a, b) LAYOUT_PHASE_CONCAT_(a, b)
+
+#ifdef LAYOUT_INSTRUMENTATION
+	/** Times the rest of the enclosing scope as nPhase, e.g. LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseAlign) */
+	#define LAYOUT_TIME_PHASE(pClock, nPhase) Layout::ScopedPhase LAYOUT_PHASE_CONCAT(aScopedPhase, __LINE__)(pClock, Layout::LayoutStats::nPhase)
+	/** Records the phases measured since the last pass */
+	#define LAYOUT_END_PASS(pClock) (pClock)->endPass()
+#else
+	#define LAYOUT_TIME_PHASE(pClock, nPhase)
+	#define LAYOUT_END_PASS(pClock)
+#endif
+
+#endif // _LAYOUT_INSTRUMENTATION_
@@ -0,0 +1,75 @@
+#ifndef _LAYOUT_LAYOUTCACHE_
+#define _LAYOUT_LAYOUTCACHE_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <list>
+#include <vector>
+
+namespace Layout
+{
+	/**
+	 * The results of recent layout passes of a manager, so that flipping back to a window size
+	 * which was laid out before (maximize/restore, snapping, moving between monitors) only applies
+	 * the stored rects instead of running the whole pass. See Manager::setLayoutCacheSize().
+	 *
+	 * A pass is determined by the window size, the splitter positions and the fold states before
+	 * it, as long as the tree, the orig rects and the visibility of the areas stay the same.
+	 * The manager clears the cache whenever one of those changes, which starts a new generation.
+	 */
+	class LAYOUT_API LayoutCache
+	{
+	public:
+		/** The state before a pass. Areas and splitters are listed in preorder of the area tree. */
+		struct Key
+		{
+			CRect rctRoot;            /// The client shape the main area is resized to
+			CRect rctWindowClient;    /// The client rect of the managed window
+			std::vector<CRect> vSplitters; /// The splitter rects
+			std::vector<BYTE> vnFolded;    /// Per area, bit Splitter::Orientation is set if folded in that orientation
+
+			bool operator==(Key const& rhs) const;
+		};
+
+		/** The rects after a pass, in the same order as the Key. Controls are listed area by area. */
+		struct Result
+		{
+			std::vector<CRect> vAreas;     /// The client shapes of the areas
+			std::vector<CRect> vSplitters; /// The splitter rects
+			std::vector<CRect> vControls;  /// The aligned control rects
+		};
+
+		/** Creates a cache holding up to nCapacity results. */
+		LayoutCache(size_t nCapacity);
+
+		/** Returns the stored result for the key, or Null. A hit becomes the most recently used entry. */
+		Result const* find(Key const& aKey);
+
+		/** Stores a result, evicting the least recently used one if the cache is full. */
+		void store(Key const& aKey, Result const& aResult);
+
+		/** Removes all results and starts a new generation. */
+		void clear();
+
+		/** Returns the generation, which changes with every clear(). A pass may only be stored if it did not change. */
+		unsigned int getGeneration() const {return m_nGeneration;}
+
+		/** Returns the number of stored results. */
+		size_t size() const {return m_lstEntries.size();}
+
+	private:
+		typedef std::pair<Key, Result> Entry;
+
+		std::list<Entry> m_lstEntries; /// Most recently used first. Only a handful of sizes, so a list beats a map.
+		size_t m_nCapacity;
+		unsigned int m_nGeneration;
+	};
+}
+
+#endif // _LAYOUT_LAYOUTCACHE_
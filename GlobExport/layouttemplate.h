@@ -0,0 +1,87 @@
+#ifndef _LAYOUT_LAYOUTTEMPLATE_
+#define _LAYOUT_LAYOUTTEMPLATE_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "description.h"
+
+namespace Layout
+{
+	/**
+	 * The immutable part of a layout, shared by all managers with the same layout identifier,
+	 * e.g. the instances of a dialog opened once per document. A template holds the parsed
+	 * description the layout is built from and the min sizes of its areas. Every instance
+	 * keeps its own controls, rects, splitter positions and fold states.
+	 *
+	 * The min sizes are only taken from the template if the instance matches its fingerprint,
+	 * i.e. all inputs of Area::updateMinSize() are equal: the orig rects, min and max sizes of
+	 * the areas, the splitter orientations and the orig rects, alignments and visibility of
+	 * the controls. Layouts with custom alignment modes are never shared.
+	 *
+	 * Templates are never changed once published, a manager which learns more publishes a new one.
+	 */
+	class LAYOUT_API LayoutTemplate
+	{
+	public:
+		typedef boost::shared_ptr<LayoutTemplate const> Ptr;
+
+		/**
+		 * Creates a template. vMinSizes lists the processed min sizes of the areas in preorder of the area tree.
+		 * sText is the description text aDescription was parsed from, empty if it was not parsed from a text.
+		 */
+		LayoutTemplate(Description const& aDescription, std::vector<int> const& vFingerprint, std::vector<SIZE> const& vMinSizes, std::string const& sText = std::string());
+
+		/** Returns the template published for the identifier, or Null. */
+		static Ptr find(std::string const& sIdentifier);
+
+		/** Publishes a template for the identifier, replacing the previous one. Managers using that one keep it. */
+		static void publish(std::string const& sIdentifier, Ptr pTemplate);
+
+		/**
+		 * Returns a template with the parsed description text. The text is only parsed by the first
+		 * instance of a layout, the others share the result as long as they pass the same text.
+		 * A different text is parsed and published instead. Without identifier nothing is shared,
+		 * the text is parsed into a template which is not published.
+		 * @param psError [optional] Receives the parse error, see Description::parse().
+		 * @return Null, if the text could not be parsed.
+		 */
+		static Ptr forDescription(std::string const& sIdentifier, char const* pchText, std::string* psError = NULL);
+
+		/** Drops all templates, e.g. after the dialog resources changed. */
+		static void clearAll();
+
+		/** The description the layout is built from. Empty if the layout was built by separate calls. */
+		Description const& getDescription() const {return m_aDescription;}
+
+		/** The text the description was parsed from. Empty if the layout was built by separate calls. */
+		std::string const& getText() const {return m_sText;}
+
+		/** Returns whether the min sizes were computed for the given fingerprint. */
+		bool matches(std::vector<int> const& vFingerprint) const {return !m_vMinSizes.empty() && vFingerprint == m_vFingerprint;}
+
+		/** The processed min sizes of the areas in preorder. Empty unless an instance was laid out. */
+		std::vector<SIZE> const& getMinSizes() const {return m_vMinSizes;}
+
+	private:
+		LayoutTemplate(LayoutTemplate const&);
+		LayoutTemplate& operator=(LayoutTemplate const&);
+
+		Description m_aDescription;
+		std::string m_sText; /// The description text, see forDescription()
+		std::vector<int> m_vFingerprint; /// The inputs of the min size computation, see Manager::getMinSizeFingerprint()
+		std::vector<SIZE> m_vMinSizes;
+	};
+}
+
+#endif // _LAYOUT_LAYOUTTEMPLATE_
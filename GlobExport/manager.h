@@ -10,6 +10,10 @@
 #include "area.h"
 #include "window.h"
 #include "areacreateparams.h"
+#include "description.h"
+#include "hittestindex.h"
+#include "layoutcache.h"
+#include "layouttemplate.h"
 
 #ifdef LAYOUT_DLL_BUILD
 	#define LAYOUT_API __declspec(dllexport)
@@ -23,6 +27,9 @@ namespace Layout
 
 	class Control;
 	class Editor;
+	class LayoutStats;
+	class PhaseClock;
+	class MessageRecorder;
 	
 	/**
 	 * Profiling modes for the Manager. Profiling means, that the managed windows
@@ -59,9 +66,24 @@ namespace Layout
 		friend class Area;
 		friend class Window;
 		friend class Editor;
+		friend class Control;
+		friend class MessageRecorder;
 		friend LRESULT ManagedLayoutWindowProc(_In_ int nCode, _In_  WPARAM wParam, _In_  LPARAM lParam);
 
 	public:
+		/** Counts the work done by the layout passes since the last update(). */
+		struct PassCounters
+		{
+			UINT nEvaluated; /// Controls whose rect was aligned
+			UINT nMoved;     /// Windows whose position changed
+			UINT nResized;   /// Windows whose size changed
+			UINT nSkipped;   /// Windows which already were at their aligned rect
+			UINT nDeferred;  /// Windows left out because they were not in the viewport
+			UINT nToggled;   /// Windows which were shown or hidden
+			UINT nMemoized;  /// 1 if the pass applied a result of the layout cache instead of aligning
+			UINT nMinSized;  /// Areas whose stale min size was recomputed
+		};
+
 		/**
 		 * Alignment Manager Ctor.
 		 * @param hParent The window whose children are to be aligned
@@ -93,6 +115,65 @@ namespace Layout
 		 */
 		LAYOUT_API bool addControl( HWND hCtrl, Align::Mode& hAlignHorz, Align::Mode& hAlignVert, std::string sName );
 		LAYOUT_API bool addControl( UINT nID, Align::Mode& hAlignHorz, Align::Mode& hAlignVert, std::string sName );
+		LAYOUT_API bool addControl( HWND hCtrl, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName );
+		LAYOUT_API bool addControl( UINT nID, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName );
+
+		/** Add a control with a compile-time alignment combination, e.g. Align::Policy<Align::Resize, Align::TopLeft>(). */
+		template<class THorz, class TVert>
+		bool addControl( HWND hCtrl, Align::Policy<THorz, TVert> const&, std::string sName )
+		{
+			return addControl(hCtrl, Align::Policy<THorz, TVert>::horz(), Align::Policy<THorz, TVert>::vert(), sName);
+		}
+
+		template<class THorz, class TVert>
+		bool addControl( UINT nID, Align::Policy<THorz, TVert> const&, std::string sName )
+		{
+			return addControl(nID, Align::Policy<THorz, TVert>::horz(), Align::Policy<THorz, TVert>::vert(), sName);
+		}
+
+		/** A control for addControls(). The modes of custom slots are copied by addControls(). */
+		struct ControlSpec
+		{
+			HWND hCtrl;
+			Align::Slot aHorz;
+			Align::Slot aVert;
+			std::string sName;
+
+			ControlSpec(HWND ctrl, Align::Slot const& horz, Align::Slot const& vert, std::string name = "") : hCtrl(ctrl), aHorz(horz), aVert(vert), sName(name) {}
+		};
+
+		/**
+		 * Add many controls at once, with the same rules as addControl(). The window rects are read in one sweep
+		 * and the new controls are distributed onto the areas in one descent of the area tree. The min sizes
+		 * are computed once by the next update().
+		 * @return The number of controls which were added. Controls added before only get their new alignment.
+		 */
+		LAYOUT_API size_t addControls( ControlSpec const* pSpecs, size_t nCount );
+
+		size_t addControls( std::vector<ControlSpec> const& vSpecs )
+		{
+			return vSpecs.empty() ? 0 : addControls(&vSpecs[0], vSpecs.size());
+		}
+
+		/**
+		 * Add a virtual control. A virtual control takes part in alignment, minimum size
+		 * and splitter logic as pure geometry. A window for it is only requested from the
+		 * VirtualControlHost (see setVirtualControlHost()) while it intersects the visible
+		 * client rect of the managed window, and handed back when it leaves it.
+		 * @param nKey The identifier of the item for the host.
+		 * @param rctOrig The original rect of the item, in client coords of the managed window.
+		 * @return The virtual control, e.g. for putSplitter(). Owned by the manager.
+		 */
+		LAYOUT_API Control const* addVirtualControl( UINT_PTR nKey, CRect const& rctOrig, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName = "" );
+
+		template<class THorz, class TVert>
+		Control const* addVirtualControl( UINT_PTR nKey, CRect const& rctOrig, Align::Policy<THorz, TVert> const&, std::string sName = "" )
+		{
+			return addVirtualControl(nKey, rctOrig, Align::Policy<THorz, TVert>::horz(), Align::Policy<THorz, TVert>::vert(), sName);
+		}
+
+		/** Set the host which creates the windows of virtual controls. Not owned by the manager. */
+		LAYOUT_API void setVirtualControlHost( VirtualControlHost* pHost ) { m_pVirtualControlHost = pHost; }
 		
 		/**
 		 * Put a splitter between two controls in the dialog.
@@ -116,7 +197,44 @@ namespace Layout
 		LAYOUT_API Splitter const* putSplitter(HWND hHigherCtrl, HWND hLowerCtrl, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
 		LAYOUT_API Splitter const* putSplitter(UINT nHigherId, UINT nLowerId, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
 		LAYOUT_API Splitter const* putSplitter(AreaProperties& aHighAreaParams, AreaProperties& aLowAreaParams, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
-		
+		LAYOUT_API Splitter const* putSplitter(Control const* pHigherCtrl, Control const* pLowerCtrl, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
+
+		/**
+		 * Make an area a grid. Its controls aligned with Align::Track are placed in the columns
+		 * or rows they reference. The tracks are sized once per pass, and the min size of the
+		 * area is at least the sum of its fixed and auto tracks.
+		 * @param pArea The area, e.g. Control::getArea() of a control within it. Null for the main area.
+		 * @param aColumns The horizontal tracks. Empty if the area is no grid horizontally.
+		 * @param aRows The vertical tracks. Empty if the area is no grid vertically.
+		 */
+		LAYOUT_API void setGrid(Area const* pArea, Tracks const& aColumns, Tracks const& aRows);
+
+		/**
+		 * Make an area a stack along nDim: Each control of the area gets an auto track of its own,
+		 * in the order of their positions, and is aligned with Align::Track in that dimension.
+		 * Across nDim the controls keep their alignment. Call it after the controls of the area are added.
+		 * @param pArea The area, e.g. Control::getArea() of a control within it. Null for the main area.
+		 * @param iGap The space between two neighbouring controls.
+		 */
+		LAYOUT_API void setStack(Area const* pArea, Align::Dimension nDim, int iGap = 0);
+
+		/**
+		 * Compile a layout description into the managers area tree.
+		 * All controls of the description are added first, then the splitters are put
+		 * in the order of the description, with the area statements applied to the
+		 * areas they create.
+		 * @param aDescription The description to be compiled. See Layout::Description.
+		 * @return True, if all controls were found and all splitters could be put.
+		 */
+		LAYOUT_API bool applyDescription(Description const& aDescription);
+
+		/**
+		 * Returns whether applyDescription() on an empty manager would rebuild the current layout: the same
+		 * windowed controls with the same built-in alignments and as many splitters. Virtual controls are not
+		 * part of a description and not compared. Used by MessageRecorder.
+		 */
+		LAYOUT_API bool matchesDescription(Description const& aDescription) const;
+
 		/**
 		 * Remove a control whose alignment is not be enforced by this manager anymore.
 		 * @param hCtrl The control to be removed.
@@ -124,6 +242,13 @@ namespace Layout
 		 * Removing will fail if the control was not added.
 		 */
 		LAYOUT_API bool removeControl( HWND hCtrl );
+
+		/**
+		 * Remove a virtual control, materialized or not. Its window is handed back to the
+		 * VirtualControlHost and the control is deleted.
+		 * @return True, if the control was removed, false if it is no virtual control of this manager.
+		 */
+		LAYOUT_API bool removeVirtualControl( Control const* pCtrl );
 		
 		/**
 		 * Get the Alignment of a control that supposedly has been added to the manager.
@@ -132,6 +257,16 @@ namespace Layout
 		 * @return True, if the control was found, false if otherwise.
 		 */
 		LAYOUT_API bool getControlAlignment( CWnd*, Align::Mode& hAlignHorz, Align::Mode& hAlignVert );
+
+		/**
+		 * Show or hide the window of a control. The manager reads the visibility of a window only when
+		 * the control is added, so a ShowWindow() on a managed control afterwards is not noticed.
+		 * A control in a hidden or folded area shows again with the area.
+		 * Within a transaction, the window is shown or hidden by the outermost commit().
+		 * @return True, if the control was found, false if otherwise. Virtual controls are not found.
+		 */
+		LAYOUT_API bool setControlVisible( HWND hCtrl, bool bVisible );
+		LAYOUT_API bool setControlVisible( UINT nID, bool bVisible );
 		
 		/**
 		 * Get the dialog window this manager has been created for
@@ -158,7 +293,7 @@ namespace Layout
 		LAYOUT_API SIZE getOrigWindowSize() const { return m_pMainArea->getOrigSize(); }
 		
 		/**
-		 * Set the base from which control ids for new splitters are allocated.
+		 * Set the base from which control ids for new layout windows are allocated.
 		 * @param nBase The new base from which control ids are to be allocated.
 		 *              Must not be used by a control in your dialog yet.
 		 *              Must be the beginning of a sufficiently big enough range of
@@ -210,6 +345,20 @@ namespace Layout
 		 */
 		LAYOUT_API void clampRect(UINT nSide, LPRECT lpRect);
 
+		/**
+		 * Publishes the root areas min and max size as the track sizes of the managed window, so that the
+		 * system clamps the sizing rect itself. Called on WM_GETMINMAXINFO, the min size is only recomputed if it is stale.
+		 * Only raises the min and lowers the max track size already in pInfo, and follows the same rules as clampRect().
+		 */
+		LAYOUT_API void getMinMaxInfo(__inout MINMAXINFO* pInfo);
+
+		/**
+		 * Set, whether getMinMaxInfo() raises the min track size of the width and of the height. Windows which
+		 * scroll when they are sized below their min size in a dimension (see ManagedDialog::MinSizeBehaviour)
+		 * turn it off for that dimension. On by default.
+		 */
+		LAYOUT_API void setMinTrackSize( bool bWidth, bool bHeight ) {m_bMinTrackWidth = bWidth; m_bMinTrackHeight = bHeight;}
+
 		/** Updates the original rects of all controls registered with the manager.
 		    This has become a necessity when adding a control AFTER the dialog has been resized. */
 		LAYOUT_API void updateAllOrigRect() const;
@@ -218,17 +367,138 @@ namespace Layout
 		LAYOUT_API void closeModalPageWindow();
 		
 		/** Delivers a new control id and increments the control id alloc base. */
-		LAYOUT_API UINT getNewControlID() const {return m_nNextControlID++;} /// Used by the splitter creation routine
+		LAYOUT_API UINT getNewControlID() const {return m_nNextControlID++;} /// Used by the layout window creation routine
+
+		/**
+		 * Delivers the leaf areas, splitters and controls whose rect contains the given point in layout coords.
+		 * Hidden elements are included. The index is maintained by the layout pass, so this takes O(log n).
+		 */
+		LAYOUT_API void hitTest( POINT ptLayout, __out std::vector<HitTestIndex::Element>& vResult ) const;
+
+		/** Delivers the leaf areas, splitters and controls whose rect intersects the given rect in layout coords. */
+		LAYOUT_API void hitTest( CRect const& rctLayout, __out std::vector<HitTestIndex::Element>& vResult ) const;
+
+		/**
+		 * Enable or disable the viewport mode. In viewport mode, a layout pass only moves the windows
+		 * of the controls which intersect the viewport (see getViewportRect()). The other controls are
+		 * aligned as geometry, their windows follow when scrollViewport() brings them into view.
+		 * Disabling the mode applies all pending rects.
+		 */
+		LAYOUT_API void setViewportMode( bool bEnable );
+
+		/** Returns whether the viewport mode is enabled. */
+		LAYOUT_API bool isViewportMode() const {return m_bViewportMode;}
+
+		/**
+		 * Scroll the managed window, so that ptOrigin (in layout coords) is shown at the top left corner of
+		 * its client rect. All child windows are moved by a single ScrollWindowEx, only pending controls
+		 * which come into view are positioned individually.
+		 */
+		LAYOUT_API void scrollViewport( POINT ptOrigin );
+
+		/** Returns the layout coords shown at the top left corner of the client rect. (0, 0) unless scrolled. */
+		LAYOUT_API CPoint const& getViewportOrigin() const {return m_ptViewportOrigin;}
+
+		/** Delivers the visible part of the layout, i.e. the client rect of the managed window in layout coords. */
+		LAYOUT_API void getViewportRect( __out CRect& rctResult ) const;
+
+		/** Returns the client rect of the managed window. It is fetched once per update(), not per area. */
+		LAYOUT_API CRect const& getWindowClientRect() const {return m_rctWindowClient;}
+
+		/**
+		 * Set how the splitters of this manager follow the mouse while they are dragged.
+		 * @param nMode One of Splitter::DragMode. Splitter::DragPreview suits slow remote sessions.
+		 * @param nFramesPerSecond [optional] The maximum layout rate of Splitter::DragThrottled.
+		 */
+		LAYOUT_API void setSplitterDragMode( Splitter::DragMode nMode, UINT nFramesPerSecond = 30 );
+
+		/** Returns the drag mode of the splitters. Splitter::DragLive unless set. */
+		LAYOUT_API Splitter::DragMode getSplitterDragMode() const {return m_nSplitterDragMode;}
+
+		/** Returns the minimum time between two layouts of a throttled splitter drag, in milliseconds. */
+		LAYOUT_API UINT getSplitterDragInterval() const {return m_nSplitterDragInterval;}
+
+		/** Returns the counters of the last update(), including splitter moves since then. */
+		LAYOUT_API PassCounters const& getPassCounters() const {return m_aPassCounters;}
+
+		/** Returns the phase latencies of all managers with the layout identifier of this one, or of this
+		    manager only if it has no identifier. Stays empty unless the library is built with LAYOUT_INSTRUMENTATION. See LayoutStats::dumpAllJson(). */
+		LAYOUT_API LayoutStats const& getLayoutStats() const;
+
+		/**
+		 * Enable the memoization of layout passes. update() then stores the resulting rects of up to
+		 * nEntries window sizes, and applies them in one batch when the window returns to one of them.
+		 * @param nEntries The number of results to keep, 0 disables the cache.
+		 */
+		LAYOUT_API void setLayoutCacheSize( UINT nEntries );
+
+		/**
+		 * Drop the memoized layout passes. The manager does this itself whenever controls, splitters, orig rects,
+		 * alignments or the visibility of areas change. Call it after changing anything else a pass depends on.
+		 */
+		LAYOUT_API void invalidateLayoutCache() const;
+
+		/**
+		 * Begin a transaction. Until the matching commit(), update() and updateAllOrigRect() are only noted,
+		 * Area::setVisible() only marks the controls, and the managed window is not painted.
+		 * Transactions nest, only the outermost commit() takes effect.
+		 */
+		LAYOUT_API void beginTransaction();
+
+		/**
+		 * End a transaction. The outermost commit() applies the deferred orig rects and visibility,
+		 * runs one layout pass over all areas, whether the window size changed or not, and repaints the window once.
+		 */
+		LAYOUT_API void commit();
+
+		/** Returns whether a transaction is open. */
+		LAYOUT_API bool isInTransaction() const {return m_nTransactionDepth > 0;}
+
+		/** Begins a transaction on construction and commits it on destruction. */
+		class Transaction
+		{
+		public:
+			explicit Transaction(Manager* pManager) : m_pManager(pManager) {m_pManager->beginTransaction();}
+			~Transaction() {m_pManager->commit();}
+
+		private:
+			Transaction(Transaction const&);
+			Transaction& operator=(Transaction const&);
+
+			Manager* m_pManager;
+		};
 
 	private:
 		mutable HWND m_hManagedWindow; /// The window this manager has been created for.
 		mutable Area* m_pMainArea;     /// The main alignment area
-		mutable UINT m_nNextControlID; /// The next control id to be assigned to a new splitter
+		mutable UINT m_nNextControlID; /// The next control id to be assigned to a new layout window
 		mutable Area const* m_pHoveredArea; /// The currently hovered area
+		HitTestIndex* m_pHitTestIndex; /// The rects of the leaf areas, splitters and controls, updated by the layout pass
 		
 		Window* m_pModalPage; /// The modal page, if set. @see putModalPage()
 		
 		std::map<HWND, Control*> m_mapHwndControl; /// A map pointing from a specific HWND to a specific Control pointer
+		std::vector<Control*> m_vVirtualControls; /// The virtual controls, materialized or not
+		VirtualControlHost* m_pVirtualControlHost; /// Creates the windows of virtual controls
+		CPoint m_ptViewportOrigin; /// The layout coords at the top left corner of the client rect
+		CRect m_rctWindowClient; /// The client rect of the managed window as of the last update()
+		LayoutCache* m_pLayoutCache; /// The memoized layout passes. Null unless enabled by setLayoutCacheSize()
+		UINT m_nTransactionDepth; /// The number of open transactions, see beginTransaction()
+		mutable bool m_bOrigRectsPending; /// updateAllOrigRect() was called in the open transaction
+		bool m_bRedrawSuspended; /// beginTransaction() turned off the redraw of the managed window
+		std::vector<Control*> m_vTransactionControls; /// Controls whose visibility changed in the open transaction
+		LayoutTemplate::Ptr m_pTemplate; /// The template shared with the other instances of this layout, see prepareMinSizes()
+		bool m_bViewportMode; /// If set, the windows of controls outside of the viewport are not moved
+		bool m_bMinTrackWidth;  /// getMinMaxInfo() raises the min track width, see setMinTrackSize()
+		bool m_bMinTrackHeight; /// getMinMaxInfo() raises the min track height, see setMinTrackSize()
+		std::vector<Control*> m_vPendingControls; /// Controls whose aligned rect has not been applied to their window
+		mutable PassCounters m_aPassCounters; /// The work done since the last update()
+		PhaseClock* m_pPhaseClock; /// Times the layout phases, see LAYOUT_TIME_PHASE
+		LayoutStats* m_pOwnStats;  /// The stats of a manager without layout identifier, not registered with LayoutStats::forIdentifier()
+		MessageRecorder* m_pMessageRecorder; /// Records the layout relevant messages while set. Not owned.
+		Splitter::DragMode m_nSplitterDragMode; /// How the splitters follow the mouse, see setSplitterDragMode()
+		UINT m_nSplitterDragInterval; /// Milliseconds between two layouts of a throttled drag
+		Splitter* m_pCapturedSplitter; /// The splitter being dragged, it has the mouse captured for the managed window
 		std::string m_sLayoutIdentifier; /// The identifier of this layout owner in the profile
 		ProfilingMode m_nProfilingMode; /// The current profiling mode of the manager
 		std::string m_sProfilingPath; /// The complete profile path where settings for this layout owner are stored
@@ -245,6 +515,58 @@ namespace Layout
 		void initMgr( HWND hParent, const SIZE& hMaxSize, const SIZE& hMinSize );
 		void initProfiling();
 
+		/** Returns the deepest area which contains the control. Uses the hit-test index,
+		    only controls which straddle a splitter are looked up by descending the area tree. */
+		Area* findOwnerArea(Control* pCtrl) const;
+
+		/** Requests or returns the window of a virtual control, depending on whether
+		    it intersects rctVisible. Called after the control has been aligned. */
+		void updateVirtualControl(Control* pCtrl, CRect const& rctVisible);
+
+		/** Drops a removed control from its area, the hit-test index and the lists of deferred controls. */
+		void detachControl(Control* pCtrl);
+
+		/** Called by update() with the layout cache enabled. Applies the memoized result for the new window rect,
+		    or runs the pass and memoizes its result. */
+		void updateFromLayoutCache(CRect const& rctWindow);
+
+		/** Runs a layout pass. If bForce is set, all areas are laid out, even if the window size did not change. */
+		void update(bool bForce);
+
+		/** Shows or hides the windows of the controls in one batch, according to their marked visibility.
+		    Virtual controls get or lose their window instead. */
+		void applyVisibility(std::vector<Control*> const& vControls);
+
+		/** Called by update() before the first pass. Takes the min sizes of the areas from the template published
+		    for the layout identifier, or computes and publishes them. */
+		void prepareMinSizes();
+
+		/** Appends the inputs of Area::updateMinSize() of the area and its children to vFingerprint.
+		    @return False, if the area tree cannot be shared, i.e. a control has a custom alignment. */
+		bool getMinSizeFingerprint(Area const* pArea, __inout std::vector<int>& vFingerprint) const;
+
+		/** Appends the processed min sizes of the area and its children to vMinSizes, in preorder. */
+		void getMinSizes(Area const* pArea, __inout std::vector<SIZE>& vMinSizes) const;
+
+		/** Sets the processed min sizes of the area and its children from a template, in the order of getMinSizes(). */
+		void seedMinSizes(Area const* pArea, std::vector<SIZE> const& vMinSizes, __inout size_t& nIndex) const;
+
+		/** Appends the splitter rects and fold states of the area and its children to aKey. */
+		void getLayoutKey(Area const* pArea, __inout LayoutCache::Key& aKey) const;
+
+		/** Appends the area, splitter and control rects of the area and its children to aResult. */
+		void getLayoutResult(Area const* pArea, __inout LayoutCache::Result& aResult) const;
+
+		/** Moves the area, its children, splitters and controls to a memoized result. The indices advance
+		    through the result in the order of getLayoutResult(), the windows are added to the batch. */
+		HDWP applyLayoutResult(Area* pArea, LayoutCache::Result const& aResult, __inout size_t& nArea, __inout size_t& nSplitter, __inout size_t& nControl, HDWP windowPosHandle, CRect const& rctVisible);
+
+		/** Called by the areas for a control whose window is left out of a layout pass in viewport mode. */
+		void deferControl(Control* pCtrl);
+
+		/** Applies the aligned rects of the pending controls which intersect the viewport, or of all of them if bAll is set. */
+		void flushPendingControls(bool bAll);
+
 		/** Returns a control for a specific hwnd */
 		Control const* getControl(HWND hCtrl);
 		
@@ -253,6 +575,21 @@ namespace Layout
 		
 		/** Called in WM_ERASEBKND from ManagedLayoutWindowProc. Draws the areas into the background. */
 		void draw(HDC hDC);
+
+		/** Returns the visible leaf area below the given point in layout coords, or Null. */
+		Area* areaAt(POINT ptLayout) const;
+
+		/** Returns the visible splitter below the given point in layout coords, or Null. */
+		Splitter* splitterAt(POINT ptLayout) const;
+
+		/** Called by ManagedLayoutWindowProc before the super window proc. Splitters have no window, so the
+		    mouse messages of the managed window are passed to the splitter below the cursor, or to the one
+		    being dragged. Returns true if a splitter handled the message. */
+		bool routeSplitterMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+		/** Called in WM_MOUSEMOVE and WM_MOUSELEAVE from ManagedLayoutWindowProc.
+		    Updates the hovered area, as the areas have no windows to receive mouse messages. */
+		void updateHoveredArea(bool bMouseLeft, POINT ptClient);
 		
 		/** Helper function called in OnMove and OnSize */
 		void storeSizeAndPosition();	
@@ -0,0 +1,104 @@
+#ifndef _LAYOUT_MESSAGETRACE_
+#define _LAYOUT_MESSAGETRACE_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace Layout
+{
+	/**
+	 * A recorded stream of the layout relevant messages of a managed window, together with
+	 * everything needed to rebuild the layout: the client size, frame and control rects at the
+	 * start of the recording and the pre-compiled Description of the layout.
+	 *
+	 * Like Description, the trace only depends on the standard library, so field traces can
+	 * be stored, loaded and inspected without any window. MessageRecorder writes traces,
+	 * MessageReplayer turns them into benchmarks. See replay.h.
+	 *
+	 * Binary format: header "DLMT" v3, control table, event table, description image.
+	 */
+	class LAYOUT_API MessageTrace
+	{
+	public:
+		/** Recorded event kinds. */
+		enum EventKind
+		{
+			EventSizing,       /// WM_SIZING. nParam: WMSZ_* edge, aiValue: the proposed window rect
+			EventSize,         /// WM_SIZE. nParam: SIZE_* type, aiValue[0..1]: client width and height
+			EventSplitterDown, /// A splitter drag started. aiValue[0]: unused, aiValue[1..2]: cursor in client coords
+			EventSplitterMove, /// A splitter was dragged. Same values as EventSplitterDown
+			EventSplitterUp    /// A splitter drag ended. Same values as EventSplitterDown
+		};
+
+		/** A control of the managed window at the start of the recording. */
+		struct ControlEntry
+		{
+			boost::uint32_t nId;  /// The dialog item id
+			boost::int32_t aiRect[4]; /// left, top, right, bottom in client coords
+		};
+
+		/** A recorded event. */
+		struct Event
+		{
+			boost::uint32_t nTimeMs; /// Milliseconds since the start of the recording
+			boost::uint16_t nKind;   /// EventKind
+			boost::uint16_t nParam;  /// See EventKind
+			boost::int32_t aiValue[4]; /// See EventKind
+		};
+
+		MessageTrace();
+
+		/** The client size of the managed window at the start of the recording. */
+		void setClientSize(int iWidth, int iHeight) {m_iWidth = iWidth; m_iHeight = iHeight;}
+		int getClientWidth() const {return m_iWidth;}
+		int getClientHeight() const {return m_iHeight;}
+
+		/** The width of the non-client frame of the managed window on each side, left, top, right and bottom.
+		    The window rects of EventSizing include this frame. */
+		void setFrame(int iLeft, int iTop, int iRight, int iBottom) {m_aiFrame[0] = iLeft; m_aiFrame[1] = iTop; m_aiFrame[2] = iRight; m_aiFrame[3] = iBottom;}
+		int getFrame(size_t nSide) const {return m_aiFrame[nSide];}
+
+		/** The pre-compiled image of the layout description, see Description::toBinary(). */
+		void setDescription(std::vector<char> const& vImage) {m_vDescription = vImage;}
+		std::vector<char> const& getDescription() const {return m_vDescription;}
+
+		/** Table accessors. */
+		void addControl(ControlEntry const& aEntry) {m_vControls.push_back(aEntry);}
+		void addEvent(Event const& aEvent) {m_vEvents.push_back(aEvent);}
+		size_t getControlCount() const {return m_vControls.size();}
+		size_t getEventCount() const {return m_vEvents.size();}
+		ControlEntry const& getControl(size_t nIndex) const {return m_vControls[nIndex];}
+		Event const& getEvent(size_t nIndex) const {return m_vEvents[nIndex];}
+
+		/** Clears the trace. */
+		void clear();
+
+		/** Delivers the binary form of this trace. */
+		void toBinary(std::vector<char>& vResult) const;
+
+		/**
+		 * Load a trace written by toBinary().
+		 * @return True, if the buffer holds a valid trace. The trace is left empty on failure.
+		 */
+		bool loadBinary(void const* pData, size_t nSize);
+
+	private:
+		int m_iWidth;
+		int m_iHeight;
+		int m_aiFrame[4]; /// See setFrame()
+		std::vector<ControlEntry> m_vControls;
+		std::vector<Event> m_vEvents;
+		std::vector<char> m_vDescription;
+	};
+}
+
+#endif // _LAYOUT_MESSAGETRACE_
@@ -80,6 +80,25 @@ namespace Layout
 		virtual LAYOUT_API bool setLayout(HWND hCtrl, std::string sID, Align::Mode& hHorzAlignment, Align::Mode& hVertAlignment);
 		virtual LAYOUT_API bool setLayout(UINT nID, Align::Mode& hHorzAlignment, Align::Mode& hVertAlignment);
 		virtual LAYOUT_API bool setLayout(HWND hCtrl, Align::Mode& hHorzAlignment, Align::Mode& hVertAlignment);
+		LAYOUT_API bool setLayout(UINT nID, std::string sID, Align::Slot const& aHorzAlignment, Align::Slot const& aVertAlignment);
+		LAYOUT_API bool setLayout(HWND hCtrl, std::string sID, Align::Slot const& aHorzAlignment, Align::Slot const& aVertAlignment);
+
+		/**
+		 * Set a compile-time alignment combination, e.g. Align::Policy<Align::Resize, Align::TopLeft>().
+		 * The built-in modes are stored by value in the control and dispatched statically.
+		 * Used by the LAYOUT_CONTROL_* macros.
+		 */
+		template<class THorz, class TVert>
+		bool setLayout(UINT nID, std::string sID, Align::Policy<THorz, TVert> const&)
+		{
+			return setLayout(nID, sID, Align::Policy<THorz, TVert>::horz(), Align::Policy<THorz, TVert>::vert());
+		}
+
+		template<class THorz, class TVert>
+		bool setLayout(HWND hCtrl, std::string sID, Align::Policy<THorz, TVert> const&)
+		{
+			return setLayout(hCtrl, sID, Align::Policy<THorz, TVert>::horz(), Align::Policy<THorz, TVert>::vert());
+		}
 		
 		/**
 		 * Set a certain alignment to all of this dialogs child controls.
@@ -109,34 +128,50 @@ namespace Layout
 		virtual LAYOUT_API Splitter const* putSplitter(HWND hHigherCtrl, HWND hLowerCtrl, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
 		virtual LAYOUT_API Splitter const* putSplitter(UINT nHigherCtrlId, UINT nLowerCtrlId, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
 		virtual LAYOUT_API Splitter const* putSplitter(AreaProperties& aHighAreaParams, AreaProperties& aLowAreaParams, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment);
+
+		/**
+		 * Builds the layout from a declarative description instead of
+		 * separate setLayout() and putSplitter() calls. Must be called from doLayoutDataExchange().
+		 * @param aDescription A parsed or pre-compiled description. See Layout::Description.
+		 * @return True, if all controls were found and all splitters could be put.
+		 */
+		virtual LAYOUT_API bool applyDescription(Description const& aDescription);
+
+		/**
+		 * Builds the layout from a description text. The text is parsed by the first instance
+		 * of this layout owner only, the others share the parsed template. See Layout::LayoutTemplate.
+		 * @param psError [optional] Receives the parse error.
+		 * @return False, if the text could not be parsed or applyDescription() failed.
+		 */
+		LAYOUT_API bool applyDescription(char const* pchText, std::string* psError = NULL);
 	};
 	
 	/** Vertical Resize, Horizontal Stretch */
-	#define LAYOUT_CONTROL_VSHS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Resize(), Layout::Align::Resize())
+	#define LAYOUT_CONTROL_VSHS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::Resize, Layout::Align::Resize>())
 	
 	/** Stick to Top, Horizontal Stretch */
-	#define LAYOUT_CONTROL_THS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Resize(), Layout::Align::TopLeft())
+	#define LAYOUT_CONTROL_THS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::Resize, Layout::Align::TopLeft>())
 	
 	/** Stick to Bottom, Horizontal Stretch */
-	#define LAYOUT_CONTROL_BHS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Resize(), Layout::Align::BottomRight())
+	#define LAYOUT_CONTROL_BHS(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::Resize, Layout::Align::BottomRight>())
 	
 	/** Vertical Stretch, Stick to Left */
-	#define LAYOUT_CONTROL_VSL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::TopLeft(), Layout::Align::Resize())
+	#define LAYOUT_CONTROL_VSL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::TopLeft, Layout::Align::Resize>())
 	
 	/** Vertical Stretch, Stick to Right */
-	#define LAYOUT_CONTROL_VSR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::BottomRight(), Layout::Align::Resize())
+	#define LAYOUT_CONTROL_VSR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::BottomRight, Layout::Align::Resize>())
 	
 	/** Stick to TopLeft */
-	#define LAYOUT_CONTROL_TL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::TopLeft(), Layout::Align::TopLeft())
+	#define LAYOUT_CONTROL_TL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::TopLeft, Layout::Align::TopLeft>())
 	
 	/** Stick to BottomRight */
-	#define LAYOUT_CONTROL_BR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::BottomRight(), Layout::Align::BottomRight())
+	#define LAYOUT_CONTROL_BR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::BottomRight, Layout::Align::BottomRight>())
 	
 	/** Stick to TopRight */
-	#define LAYOUT_CONTROL_TR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::BottomRight(), Layout::Align::TopLeft())
+	#define LAYOUT_CONTROL_TR(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::BottomRight, Layout::Align::TopLeft>())
 	
 	/** Stick to BottomLeft */
-	#define LAYOUT_CONTROL_BL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::TopLeft(), Layout::Align::BottomRight())
+	#define LAYOUT_CONTROL_BL(ctrl) setLayout(ctrl, #ctrl, Layout::Align::Policy<Layout::Align::TopLeft, Layout::Align::BottomRight>())
 	
 	#define LAYOUT_AREAPROPS(name, control, color) AreaProperties name; name.setControl(control); name.setColor(color);
 }
@@ -0,0 +1,80 @@
+#ifndef _LAYOUT_REPLAY_
+#define _LAYOUT_REPLAY_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <vector>
+
+#include "messagetrace.h"
+
+namespace Layout
+{
+	class Manager;
+	class Description;
+
+	/**
+	 * Records the layout relevant messages of a managed window into a MessageTrace:
+	 * WM_SIZING, WM_SIZE (including maximize and restore) and splitter drags.
+	 * Recording starts with the construction and ends with the destruction of the recorder.
+	 */
+	class LAYOUT_API MessageRecorder
+	{
+	public:
+		/**
+		 * Start recording. The current client size, frame and control rects are stored as the initial state.
+		 * Nothing is recorded, if the description does not match the layout of the manager, e.g. for a
+		 * layout built in code, or if two controls share a dialog item id. See Manager::matchesDescription()
+		 * and isRecording().
+		 * @param aDescription The description the layout of the manager was built from.
+		 */
+		MessageRecorder(Manager* pManager, Description const& aDescription);
+
+		/** Stops recording. */
+		~MessageRecorder();
+
+		/** Returns whether the recorder is attached to the manager, i.e. the description matched its layout. */
+		bool isRecording() const {return m_bRecording;}
+
+		/** Returns the trace recorded so far. */
+		MessageTrace const& getTrace() const {return m_aTrace;}
+
+		/** Appends an event. Called by the manager and its splitters. */
+		void record(MessageTrace::EventKind nKind, unsigned int nParam, int iValue0, int iValue1 = 0, int iValue2 = 0, int iValue3 = 0);
+
+	private:
+		MessageRecorder(MessageRecorder const&);
+		MessageRecorder& operator=(MessageRecorder const&);
+
+		Manager* m_pManager;
+		MessageTrace m_aTrace;
+		DWORD m_nStartTick; /// GetTickCount() at the start of the recording
+		bool m_bRecording;  /// The description matched, the manager reports its messages to this recorder
+	};
+
+	/**
+	 * Replays a MessageTrace against a hidden window. The window gets static controls with the
+	 * recorded ids and rects, and a Manager which applies the recorded description. The recorded
+	 * window rects are converted to the frame of the replay window, so the client sizes match. The events
+	 * are then sent one by one as quickly as possible, so the replay is deterministic and
+	 * independent of the timing of the recording.
+	 */
+	class LAYOUT_API MessageReplayer
+	{
+	public:
+		/**
+		 * Replay a trace.
+		 * @param vLatencyUs [out] Receives the time each event took to process, in microseconds.
+		 * @param pvFinalControls [out, optional] Receives the control table with the rects after the last event.
+		 * @return False, if the description of the trace is invalid, two controls share an id or the window could not be created.
+		 */
+		static bool replay(MessageTrace const& aTrace, std::vector<double>& vLatencyUs, std::vector<MessageTrace::ControlEntry>* pvFinalControls = NULL);
+	};
+}
+
+#endif // _LAYOUT_REPLAY_
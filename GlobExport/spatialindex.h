@@ -0,0 +1,97 @@
+#ifndef _LAYOUT_SPATIALINDEX_
+#define _LAYOUT_SPATIALINDEX_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <vector>
+#include <utility>
+#include <iterator>
+
+#include <boost/geometry.hpp>
+#include <boost/geometry/geometries/point.hpp>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+namespace Layout
+{
+	/**
+	 * R-tree of client rects with an associated value each.
+	 * Finds the values whose rect contains, intersects or covers a point
+	 * in O(log n). Rects are treated as closed, so a query delivers
+	 * candidates which have to be checked with the exact CRect semantics.
+	 */
+	template<class TValue>
+	class SpatialIndex
+	{
+	public:
+		typedef boost::geometry::model::point<long, 2, boost::geometry::cs::cartesian> Point;
+		typedef boost::geometry::model::box<Point> Box;
+		typedef std::pair<Box, TValue> Entry;
+
+		/** Converts a CRect to an index box. */
+		static Box toBox(CRect const& rct) { return Box(Point(rct.left, rct.top), Point(rct.right, rct.bottom)); }
+
+		/** Removes all entries. */
+		void clear() { m_aTree.clear(); }
+
+		/** Returns the number of entries. */
+		size_t size() const { return m_aTree.size(); }
+
+		/** Returns whether the index is empty. */
+		bool empty() const { return m_aTree.empty(); }
+
+		/** Inserts a single value. */
+		void insert(CRect const& rct, TValue const& value) { m_aTree.insert(Entry(toBox(rct), value)); }
+
+		/** Removes a value. The rect must equal the one it was inserted with. */
+		bool remove(CRect const& rct, TValue const& value) { return m_aTree.remove(Entry(toBox(rct), value)) > 0; }
+
+		/** Replaces all entries. The tree is bulk loaded, which is faster
+		    and yields a better tree than inserting the entries one by one. */
+		void assign(std::vector<Entry> const& vEntries)
+		{
+			Tree aTree(vEntries.begin(), vEntries.end());
+			m_aTree.swap(aTree);
+		}
+
+		/** Delivers the values whose rect contains rct. */
+		void queryContaining(CRect const& rct, std::vector<TValue>& vResult) const
+		{
+			query(boost::geometry::index::contains(toBox(rct)), vResult);
+		}
+
+		/** Delivers the values whose rect intersects rct. */
+		void queryIntersecting(CRect const& rct, std::vector<TValue>& vResult) const
+		{
+			query(boost::geometry::index::intersects(toBox(rct)), vResult);
+		}
+
+		/** Delivers the values whose rect covers pt. */
+		void queryPoint(POINT pt, std::vector<TValue>& vResult) const
+		{
+			query(boost::geometry::index::intersects(Point(pt.x, pt.y)), vResult);
+		}
+
+	private:
+		typedef boost::geometry::index::rtree<Entry, boost::geometry::index::rstar<16> > Tree;
+
+		template<class TPredicate>
+		void query(TPredicate const& aPredicate, std::vector<TValue>& vResult) const
+		{
+			std::vector<Entry> vEntries;
+			m_aTree.query(aPredicate, std::back_inserter(vEntries));
+			for(typename std::vector<Entry>::const_iterator it = vEntries.begin(); it != vEntries.end(); ++it)
+				vResult.push_back(it->second);
+		}
+
+		Tree m_aTree;
+	};
+}
+
+#endif // _LAYOUT_SPATIALINDEX_
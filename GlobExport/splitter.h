@@ -13,10 +13,15 @@
 
 namespace Layout
 {
-	class Splitter : public CStatic, public Control
+	/**
+	 * A splitter between two neighbouring child areas of an area. Splitters have no window: the manager
+	 * draws them into the background of the managed window and routes the mouse messages
+	 * of the managed window to the splitter below the cursor. See Manager::routeSplitterMessage().
+	 */
+	class Splitter : public Control
 	{
-		DECLARE_DYNAMIC(Splitter)
 		friend class Area;
+		friend class Manager;
 		
 	public:
 		enum SplitterAlignment
@@ -32,9 +37,20 @@ namespace Layout
 			Vertical
 		};
 
+		/** How a dragged splitter lays out its child areas, see Manager::setSplitterDragMode(). */
+		enum DragMode
+		{
+			DragLive,      /// The child areas are laid out on every mouse move
+			DragPreview,   /// Only a tracking line follows the mouse, the child areas are laid out once on release
+			DragThrottled  /// Like DragLive, but at most once per frame interval. The last move is laid out by a timer
+		};
+
+		/** The WM_TIMER id a throttled drag uses on the managed window. */
+		enum { DragTimerId = 0x4C53 };
+
 	private:
 		static Splitter* Create(Area const* pArea, CRect rctSplitter, Orientation nOrientation, SplitterAlignment nAlignment);
-		Splitter(Area const* pArea, HWND hWnd, Orientation nOrientation, SplitterAlignment nAlignment );
+		Splitter(Area const* pArea, CRect const& rctSplitter, Orientation nOrientation, SplitterAlignment nAlignment );
 		virtual ~Splitter();
 		
 	public:
@@ -43,8 +59,12 @@ namespace Layout
 		
 		/** Delivers the orientation of the splitter. */
 		LAYOUT_API Orientation getOrientation() const {return m_nOrientation;}
+
+		/** Delivers the position of the splitter in its area, see Area::getSplitter(size_t). */
+		LAYOUT_API size_t getIndex() const {return m_nIndex;}
 		
-		/** Moves the splitter horizontally OR vertically, depending on its orientation.  */
+		/** Moves the splitter horizontally OR vertically, depending on its orientation.
+			The child areas are not updated and the orig rects are left untouched. */
 		LAYOUT_API bool move(int iHorzPos, int iVertPos);
 		
 		/** Set the color used to draw the handle dots.  */
@@ -56,22 +76,56 @@ namespace Layout
 		
 		/** Returns if the user is currently dragging the splitter. */
 		virtual LAYOUT_API bool isDraggedByUser() const {return m_bDragging;}
+
+		/** Returns whether the splitter is shown, i.e. neither its area is hidden nor folded. */
+		LAYOUT_API bool isVisible() const {return isShown();}
 		
 	protected:
-		DECLARE_MESSAGE_MAP()
-		
-		afx_msg void OnMouseMove(UINT nFlags, CPoint point);
-		afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
-		afx_msg void OnLButtonUp(UINT nFlags, CPoint point);
-		afx_msg BOOL OnSetCursor(CWnd* pWnd, UINT nHitTest, UINT message);
-		afx_msg BOOL OnEraseBkgnd(CDC* pDC) {return TRUE;}
-		afx_msg virtual void DrawItem(LPDRAWITEMSTRUCT lpDrawItemStruct);
+		/** Mouse messages of the managed window, routed by the manager. The points are in client coords. */
+		void OnMouseMove(UINT nFlags, CPoint point);
+		void OnLButtonDown(UINT nFlags, CPoint point);
+		void OnLButtonUp(UINT nFlags, CPoint point);
+		void OnSetCursor();
+		void OnTimer();
+
+		/** Draws the handle dots. The DC is in layout coords. Called by the area of the splitter. */
+		void draw(HDC hDC) const;
+
+		/** Moves the current rect to where the alignment puts it, without checking the min sizes of the child areas. */
+		void alignRect();
+
+		/** Invalidates the background of the managed window below the given rect in layout coords. */
+		void invalidate(CRect const& rctLayout) const;
+
+		/** Moves the entry of the splitter in the hit-test index of the manager to the current rect. */
+		void updateHitTestEntry() const;
 		
 	private:
 		SplitterAlignment m_nAlignment;
 		Orientation m_nOrientation;
+		size_t m_nIndex;           /// The position in the splitter list of the area, maintained by the area
 		bool m_bDragging;
 		COLORREF m_hHandleColor;
+		CPoint m_ptDragTarget;     /// The last drag position in layout coords
+		bool m_bDragTargetSet;     /// False until the mouse moved during the current drag
+		DWORD m_nLastLayoutTick;   /// GetTickCount() of the last layout of a throttled drag
+		CRect m_rctTracker;        /// The tracking line of a preview drag in client coords
+		bool m_bTrackerShown;      /// True while the tracking line is drawn
+
+		/** Moves the splitter to the given position in layout coords and lays out the child areas. */
+		void dragTo(CPoint ptLayout);
+
+		/** Draws the tracking line of a preview drag at the splitter rect the given position results in. */
+		void showTracker(CPoint ptLayout);
+
+		/** Removes the tracking line, if shown. */
+		void hideTracker();
+
+		/** Inverts the given rect of the managed window, across its child windows. */
+		void invertTracker(CRect const& rctTracker) const;
+
+		/** Hands a drag message to the message recorder of the manager, if one is recording. */
+		void recordDrag(int nEventKind, CPoint point) const;
 	};
 }
 
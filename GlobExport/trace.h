@@ -0,0 +1,79 @@
+#ifndef _LAYOUT_TRACE_
+#define _LAYOUT_TRACE_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <string>
+
+namespace Layout
+{
+	/**
+	 * Structured trace of the layout engine. Events are written to a ring buffer per thread,
+	 * which only its own thread writes to, so recording takes no lock. flush() collects the
+	 * events of all threads as Chrome trace event JSON, which chrome://tracing and Perfetto load.
+	 *
+	 * The engine only records events if the library is built with LAYOUT_TRACING defined,
+	 * otherwise the LAYOUT_TRACE_* macros expand to nothing.
+	 */
+	class LAYOUT_API Trace
+	{
+	public:
+		/** Number of events kept per thread. Older events are overwritten. */
+		enum { BufferCapacity = 8192 };
+
+		/**
+		 * Record the begin of a duration event.
+		 * @param pchName The event name. Must be a string literal, only the pointer is stored.
+		 * @param pchDetail [optional] Copied and truncated to a few dozen characters, e.g. an area name.
+		 * @param iDepth [optional] Nesting depth of the traced object, -1 if there is none.
+		 */
+		static void begin(char const* pchName, char const* pchDetail = NULL, int iDepth = -1);
+
+		/** Record the end of the duration event begun last by the calling thread. */
+		static void end(char const* pchName);
+
+		/** Record an event without duration. Same parameters as begin(). */
+		static void instant(char const* pchName, char const* pchDetail = NULL, int iDepth = -1);
+
+		/**
+		 * Append the events recorded since the last flush() as a Chrome trace JSON object.
+		 * Events which a thread overwrites while they are read are left out.
+		 */
+		static void flush(std::string& sResult);
+	};
+
+	/** Records the enclosing scope as a duration event. */
+	class ScopedTrace
+	{
+	public:
+		ScopedTrace(char const* pchName, char const* pchDetail = NULL, int iDepth = -1) : m_pchName(pchName) { Trace::begin(pchName, pchDetail, iDepth); }
+		~ScopedTrace() { Trace::end(m_pchName); }
+
+	private:
+		char const* m_pchName;
+	};
+}
+
+#define LAYOUT_TRACE_CONCAT_(a, b) a##b
+#define LAYOUT_TRACE_CONCAT(a, b) LAYOUT_TRACE_CONCAT_(a, b)
+
+#ifdef LAYOUT_TRACING
+	/** Records the rest of the enclosing scope, e.g. LAYOUT_TRACE_SCOPE("Manager::update") */
+	#define LAYOUT_TRACE_SCOPE(pchName) Layout::ScopedTrace LAYOUT_TRACE_CONCAT(aScopedTrace, __LINE__)(pchName)
+	/** Records the rest of the enclosing scope with a detail string and depth. The arguments are only evaluated when tracing. */
+	#define LAYOUT_TRACE_SCOPE_DETAIL(pchName, pchDetail, iDepth) Layout::ScopedTrace LAYOUT_TRACE_CONCAT(aScopedTrace, __LINE__)(pchName, pchDetail, iDepth)
+	/** Records an event without duration */
+	#define LAYOUT_TRACE_INSTANT(pchName, pchDetail) Layout::Trace::instant(pchName, pchDetail)
+#else
+	#define LAYOUT_TRACE_SCOPE(pchName)
+	#define LAYOUT_TRACE_SCOPE_DETAIL(pchName, pchDetail, iDepth)
+	#define LAYOUT_TRACE_INSTANT(pchName, pchDetail)
+#endif
+
+#endif // _LAYOUT_TRACE_
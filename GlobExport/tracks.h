@@ -0,0 +1,102 @@
+#ifndef _LAYOUT_TRACKS_
+#define _LAYOUT_TRACKS_
+
+#pragma once
+
+#ifdef LAYOUT_DLL_BUILD
+	#define LAYOUT_API __declspec(dllexport)
+#else
+	#define LAYOUT_API __declspec(dllimport)
+#endif
+
+#include <vector>
+
+namespace Layout
+{
+	/**
+	 * The rows or the columns of a grid area. The tracks are sized once per layout pass by layout(),
+	 * the controls aligned with Align::Track only look up the edges of the tracks they span.
+	 * See Manager::setGrid() and Manager::setStack().
+	 *
+	 * - Fixed tracks have a size in pixels.
+	 * - Auto tracks are as large as the largest original size of the shown controls within them.
+	 *   Controls spanning several tracks do not size auto tracks.
+	 * - Proportional tracks share the remaining space by their weights.
+	 *
+	 * The minimum size is the sum of the fixed and auto tracks and the gaps between all tracks.
+	 */
+	class LAYOUT_API Tracks
+	{
+	public:
+		enum Kind
+		{
+			KindFixed,
+			KindAuto,
+			KindProportional
+		};
+
+		/** A track definition. */
+		struct Track
+		{
+			Kind nKind;
+			int iValue; /// The size for KindFixed, the weight for KindProportional, unused for KindAuto
+
+			Track(Kind kind = KindAuto, int value = 0) : nKind(kind), iValue(value) {}
+		};
+
+		/** Creates empty tracks. An area without tracks is no grid. */
+		Tracks(int iGap = 0);
+
+		/** Appends a track. */
+		void add(Kind nKind, int iValue = 0);
+
+		/** Removes all tracks. */
+		void clear();
+
+		/** Returns whether there are no tracks. */
+		bool empty() const {return m_vTracks.empty();}
+
+		/** Returns the number of tracks. */
+		size_t size() const {return m_vTracks.size();}
+
+		/** Returns a track definition. */
+		Track const& getTrack(size_t nIndex) const {return m_vTracks[nIndex];}
+
+		/** Set the space between two neighbouring tracks. */
+		void setGap(int iGap) {m_iGap = iGap;}
+		int getGap() const {return m_iGap;}
+
+		/** Sets the content size of all auto tracks to 0, before fitContent() is called for each control. */
+		void resetContent();
+
+		/** Grows the auto track nIndex to at least iSize. Ignored for other tracks, spans and invalid indexes. */
+		void fitContent(size_t nIndex, size_t nSpan, int iSize);
+
+		/** Returns the sum of the fixed and auto tracks and the gaps. */
+		int getMinSize() const;
+
+		/**
+		 * Sizes the tracks for the given space in one pass. The remaining space beyond the minimum size is
+		 * distributed by the weights of the proportional tracks, each track gets its rounded share of the
+		 * running weight sum, so that the shares always add up exactly.
+		 */
+		void layout(int iStart, int iLength);
+
+		/**
+		 * Delivers the edges of the tracks nIndex to nIndex + nSpan - 1 as sized by the last layout().
+		 * @return False, if the tracks were not laid out yet or the span is out of range.
+		 */
+		bool getSpan(size_t nIndex, size_t nSpan, int& iStart, int& iEnd) const;
+
+		/** Appends the definitions to vFingerprint, see Manager::getMinSizeFingerprint(). */
+		void appendFingerprint(std::vector<int>& vFingerprint) const;
+
+	private:
+		std::vector<Track> m_vTracks;
+		std::vector<int> m_vnContent; /// The content size per auto track, see fitContent()
+		std::vector<int> m_viEdges;   /// Start and end per track after layout(), empty before
+		int m_iGap;
+	};
+}
+
+#endif // _LAYOUT_TRACKS_
@@ -12,6 +12,11 @@ using namespace Layout;
  * The control will stick to the parents top/left edge, the width will be constant.
  */
 void Align::TopLeft::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
+{
+	apply(pCtrl, nDim, rctResult);
+}
+
+void Align::TopLeft::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult )
 {
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
 	CRect const& rctArea = pCtrl->getArea()->getClientRect();
@@ -29,6 +34,11 @@ void Align::TopLeft::update( Control* pCtrl, Align::Dimension nDim, CRect& rctRe
 }
 
 void Align::TopLeft::getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, CRect& bounds)
+{
+	minInsets(pCtrl, nDimension, bounds);
+}
+
+void Align::TopLeft::minInsets( Control const* pCtrl, Dimension nDimension, CRect& bounds )
 {
 	CRect const& rctCtrlOrig = pCtrl->getOrigRect();
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
@@ -48,6 +58,11 @@ void Align::TopLeft::getMinInsets(__in Control const* pCtrl, __in Dimension nDim
  * the parents left/top and right/bottom edge are always constant.
  */
 void Align::Resize::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
+{
+	apply(pCtrl, nDim, rctResult);
+}
+
+void Align::Resize::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult )
 {
 	int iDiff = 0;
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
@@ -70,17 +85,22 @@ void Align::Resize::update( Control* pCtrl, Align::Dimension nDim, CRect& rctRes
 }
 
 void Align::Resize::getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, CRect& bounds)
+{
+	minInsets(pCtrl, nDimension, bounds, m_iMinSize);
+}
+
+void Align::Resize::minInsets( Control const* pCtrl, Dimension nDimension, CRect& bounds, int iMinSize )
 {
 	CRect const& rctCtrlOrig = pCtrl->getOrigRect();
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
 	
 	if( nDimension == Horizontal ) {
-		bounds.left = rctCtrlOrig.left - rctAreaOrig.left + m_iMinSize/2;
-		bounds.right = rctAreaOrig.right - rctCtrlOrig.right + m_iMinSize/2;
+		bounds.left = rctCtrlOrig.left - rctAreaOrig.left + iMinSize/2;
+		bounds.right = rctAreaOrig.right - rctCtrlOrig.right + iMinSize/2;
 	}
 	else {
-		bounds.top = rctCtrlOrig.top - rctAreaOrig.top + m_iMinSize/2;
-		bounds.bottom = rctAreaOrig.bottom - rctCtrlOrig.bottom + m_iMinSize/2;
+		bounds.top = rctCtrlOrig.top - rctAreaOrig.top + iMinSize/2;
+		bounds.bottom = rctAreaOrig.bottom - rctCtrlOrig.bottom + iMinSize/2;
 	}
 }
 
@@ -89,6 +109,11 @@ void Align::Resize::getMinInsets(__in Control const* pCtrl, __in Dimension nDime
  * always equals the top/left distance to the corresponding parent edge
  */
 void Align::Fit::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
+{
+	apply(pCtrl, nDim, rctResult);
+}
+
+void Align::Fit::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult )
 {
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
 	CRect const& rctArea = pCtrl->getArea()->getClientRect();
@@ -104,6 +129,11 @@ void Align::Fit::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult
  * the width/height will be constant.
  */
 void Align::BottomRight::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
+{
+	apply(pCtrl, nDim, rctResult);
+}
+
+void Align::BottomRight::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult )
 {
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
 	CRect const& rctArea = pCtrl->getArea()->getClientRect();
@@ -121,6 +151,11 @@ void Align::BottomRight::update( Control* pCtrl, Align::Dimension nDim, CRect& r
 }
 
 void Align::BottomRight::getMinInsets(__in Control const* pCtrl, __in Dimension nDimension, CRect& bounds)
+{
+	minInsets(pCtrl, nDimension, bounds);
+}
+
+void Align::BottomRight::minInsets( Control const* pCtrl, Dimension nDimension, CRect& bounds )
 {
 	CRect const& rctCtrlOrig = pCtrl->getOrigRect();
 	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
@@ -147,31 +182,125 @@ Align::Relative::Relative(bool bResize)
  */
 void Align::Relative::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
 {
-	CRect const& rctAreaOrig = pCtrl->getArea()->getOrigClientRect();
-	CRect const& rctArea = pCtrl->getArea()->getClientRect();
+	apply(pCtrl, nDim, rctResult, m_bResize);
+}
+
+/**
+ * Scales an offset by a 16.16 fixed point factor, rounded to nearest.
+ * Truncating would make positions creep towards the area origin whenever the orig rects are rebased.
+ */
+static LONG ScaleOffset( LONG lOffset, boost::int32_t iScale )
+{
+	return (LONG) (((boost::int64_t) lOffset * iScale + 0x8000) >> 16);
+}
+
+void Align::Relative::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult, bool bResize )
+{
+	Area const* pArea = pCtrl->getArea();
+	CRect const& rctAreaOrig = pArea->getOrigClientRect();
+	CRect const& rctArea = pArea->getClientRect();
+	boost::int32_t iScale = pArea->getRelativeScale(nDim);
 	
 	if( nDim == Horizontal )
 	{
-		double dFactorX = (double)(rctArea.Width()) / (double)(rctAreaOrig.Width());
-		
-		if( m_bResize )
+		if( bResize )
 		{
-			rctResult.right = (LONG)((pCtrl->getOrigRect().right - rctAreaOrig.left) * dFactorX) + rctArea.left;
-			rctResult.left = (LONG)((pCtrl->getOrigRect().left - rctAreaOrig.left) * dFactorX) + rctArea.left;
+			rctResult.right = ScaleOffset(pCtrl->getOrigRect().right - rctAreaOrig.left, iScale) + rctArea.left;
+			rctResult.left = ScaleOffset(pCtrl->getOrigRect().left - rctAreaOrig.left, iScale) + rctArea.left;
 		}
 		else
-			rctResult.MoveToX((LONG)((pCtrl->getOrigRect().left - rctAreaOrig.left) * dFactorX) + rctArea.left);
+			rctResult.MoveToX(ScaleOffset(pCtrl->getOrigRect().left - rctAreaOrig.left, iScale) + rctArea.left);
 	}
 	else
 	{
-		double dFactorY = (double)(rctArea.Height()) / (double)(rctAreaOrig.Height());
-		
-		if( m_bResize )
+		if( bResize )
 		{
-			rctResult.bottom = (LONG)((pCtrl->getOrigRect().bottom - rctAreaOrig.top) * dFactorY) + rctArea.top;
-			rctResult.top = (LONG)((pCtrl->getOrigRect().top - rctAreaOrig.top) * dFactorY) + rctArea.top;
+			rctResult.bottom = ScaleOffset(pCtrl->getOrigRect().bottom - rctAreaOrig.top, iScale) + rctArea.top;
+			rctResult.top = ScaleOffset(pCtrl->getOrigRect().top - rctAreaOrig.top, iScale) + rctArea.top;
 		}
 		else
-			rctResult.MoveToY((LONG)((pCtrl->getOrigRect().top - rctAreaOrig.top) * dFactorY) + rctArea.top);
+			rctResult.MoveToY(ScaleOffset(pCtrl->getOrigRect().top - rctAreaOrig.top, iScale) + rctArea.top);
+	}
+}
+
+/**
+ * The control spans tracks of the grid of its area. The tracks were sized by the area before its controls are aligned.
+ */
+void Align::Track::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult )
+{
+	apply(pCtrl, nDim, rctResult, m_iParam);
+}
+
+void Align::Track::apply( Control const* pCtrl, Align::Dimension nDim, CRect& rctResult, int iParam )
+{
+	int iStart = 0, iEnd = 0;
+	if(!pCtrl->getArea()->getTracks(nDim).getSpan(index(iParam), span(iParam), iStart, iEnd))
+	{
+		TopLeft::apply(pCtrl, nDim, rctResult);
+		return;
+	}
+
+	if( nDim == Horizontal )
+	{
+		rctResult.left = iStart;
+		rctResult.right = iEnd;
+	}
+	else
+	{
+		rctResult.top = iStart;
+		rctResult.bottom = iEnd;
+	}
+}
+
+/**
+ * Enforces the alignment of a slot. The built-in kinds are
+ * dispatched to the static apply functions of the modes.
+ */
+void Align::Slot::update( Control* pCtrl, Align::Dimension nDim, CRect& rctResult ) const
+{
+	switch(nKind)
+	{
+	case KindTopLeft: TopLeft::apply(pCtrl, nDim, rctResult); break;
+	case KindResize: Resize::apply(pCtrl, nDim, rctResult); break;
+	case KindFit: Fit::apply(pCtrl, nDim, rctResult); break;
+	case KindBottomRight: BottomRight::apply(pCtrl, nDim, rctResult); break;
+	case KindRelative: Relative::apply(pCtrl, nDim, rctResult, false); break;
+	case KindRelativeResize: Relative::apply(pCtrl, nDim, rctResult, true); break;
+	case KindTrack: Track::apply(pCtrl, nDim, rctResult, iParam); break;
+	default:
+		if(pMode)
+			pMode->update(pCtrl, nDim, rctResult);
+	}
+}
+
+void Align::Slot::getMinInsets( Control const* pCtrl, Align::Dimension nDim, CRect& insets ) const
+{
+	switch(nKind)
+	{
+	case KindTopLeft: TopLeft::minInsets(pCtrl, nDim, insets); break;
+	case KindResize: Resize::minInsets(pCtrl, nDim, insets, iParam); break;
+	case KindBottomRight: BottomRight::minInsets(pCtrl, nDim, insets); break;
+	case KindFit:
+	case KindRelative:
+	case KindRelativeResize:
+	case KindTrack: insets.SetRect(0, 0, 0, 0); break;
+	default:
+		if(pMode)
+			pMode->getMinInsets(pCtrl, nDim, insets);
+	}
+}
+
+Align::Mode* Align::Slot::createMode() const
+{
+	switch(nKind)
+	{
+	case KindTopLeft: return new TopLeft();
+	case KindResize: return new Resize(iParam);
+	case KindFit: return new Fit();
+	case KindBottomRight: return new BottomRight();
+	case KindRelative: return new Relative(false);
+	case KindRelativeResize: return new Relative(true);
+	case KindTrack: return new Track(Track::index(iParam), Track::span(iParam));
+	default: return pMode ? pMode->copy() : NULL;
 	}
 }
@@ -4,6 +4,8 @@
 #include "../../GlobExport/area.h"
 #include "../../GlobExport/manager.h"
 #include "../../GlobExport/gdiplusutil.h"
+#include "../../GlobExport/instrumentation.h"
+#include "../../GlobExport/trace.h"
 
 #include <boost/icl/interval_map.hpp>
 #include <boost/filesystem/path.hpp>
@@ -11,7 +13,6 @@
 #include <algorithm>
 #include <limits>
 #include <sstream>
-#include <list>
 
 using namespace Layout;
 
@@ -70,6 +71,35 @@ int CalcMinSize(const boost::icl::interval_map<int, MaxDistance>& low, const boo
 	
 	return minSize;
 }
+
+/**
+ * The part of rctOuter between two splitter rects along the split dimension. A missing splitter
+ * leaves the edge of rctOuter. All rects are in the same coords.
+ */
+void GetShapeBetween(CRect const& rctOuter, Splitter::Orientation nOrientation, CRect const* prctBefore, CRect const* prctAfter, CRect& rctShape)
+{
+	rctShape = rctOuter;
+	if(nOrientation == Splitter::Horizontal)
+	{
+		if(prctBefore)
+			rctShape.top = prctBefore->bottom;
+		if(prctAfter)
+			rctShape.bottom = prctAfter->top;
+	}
+	else
+	{
+		if(prctBefore)
+			rctShape.left = prctBefore->right;
+		if(prctAfter)
+			rctShape.right = prctAfter->left;
+	}
+}
+
+/** Returns true, if the control lies within the given rect in client coords. */
+bool ContainsControl(CRect const& rctClient, Control const* pCtrl)
+{
+	return rctClient.PtInRect(pCtrl->getRect().TopLeft()) && rctClient.PtInRect(pCtrl->getRect().BottomRight());
+}
 }
 
 POINT Layout::Area::addToClientRectVisibleTopLeftPoint( int iOffX, int iOffY )
@@ -83,8 +113,7 @@ POINT Layout::Area::addToClientRectVisibleTopLeftPoint( int iOffX, int iOffY )
 CRect Layout::Area::getVisibleClientRect()
 {
 	CRect rctVisibleRegion = m_rctCurrentClientShape;
-	CRect rctWindowClientRect;
-	getManager()->getWnd()->GetClientRect(&rctWindowClientRect);
+	CRect const& rctWindowClientRect = getManager()->getWindowClientRect();
 
 	if(rctVisibleRegion.top < rctWindowClientRect.top)
 		rctVisibleRegion.top = rctWindowClientRect.top;
@@ -95,16 +124,13 @@ CRect Layout::Area::getVisibleClientRect()
 	if(rctVisibleRegion.right > rctWindowClientRect.right)
 		rctVisibleRegion.right = rctWindowClientRect.right;
 
-	bool bTop(true), bBottom(true), bLeft(true), bRight(true);
-	getTouchedParentWindowEdges(bTop, bBottom, bLeft, bRight);
-
-	if(bTop)
+	if(m_nTouchedEdges & EdgeTop)
 		rctVisibleRegion.top += _LAYOUT_AREA_BORDERSIZE;
-	if(bBottom)
+	if(m_nTouchedEdges & EdgeBottom)
 		rctVisibleRegion.bottom -= _LAYOUT_AREA_BORDERSIZE;
-	if(bLeft)
+	if(m_nTouchedEdges & EdgeLeft)
 		rctVisibleRegion.left += _LAYOUT_AREA_BORDERSIZE;
-	if(bRight)
+	if(m_nTouchedEdges & EdgeRight)
 		rctVisibleRegion.right -= _LAYOUT_AREA_BORDERSIZE;
 
 	return rctVisibleRegion;
@@ -112,40 +138,59 @@ CRect Layout::Area::getVisibleClientRect()
 
 void Area::getTouchedParentWindowEdges( __inout bool& bTop, __inout bool& bBottom, __inout bool& bLeft, __inout bool& bRight ) const
 {
-	if(getParent())
-	{
-		getParent()->getTouchedParentWindowEdges(bTop, bBottom, bLeft, bRight);
+	bTop = bTop && (m_nTouchedEdges & EdgeTop) != 0;
+	bBottom = bBottom && (m_nTouchedEdges & EdgeBottom) != 0;
+	bLeft = bLeft && (m_nTouchedEdges & EdgeLeft) != 0;
+	bRight = bRight && (m_nTouchedEdges & EdgeRight) != 0;
+}
 
-		if(
-			bTop &&
-			getParent()->getSplitter()->getOrientation() == Splitter::Horizontal &&
-			isLoArea()
-		)
-			bTop = false;
+void Area::updateTopology()
+{
+	m_nTouchedEdges = EdgeAll;
+	m_abHiArea[Splitter::Horizontal] = true;
+	m_abHiArea[Splitter::Vertical] = true;
 
-		if(
-			bBottom &&
-			getParent()->getSplitter()->getOrientation() == Splitter::Horizontal &&
-			isHiArea()
-		)
-			bBottom = false;
+	Area const* pParent = getParent();
+	if(!pParent)
+		return;
 
-		if(
-			bLeft &&
-			getParent()->getSplitter()->getOrientation() == Splitter::Vertical &&
-			isLoArea()
-		)
-			bLeft = false;
+	// An area touches the edges its parent touches, except the ones towards the parent's splitters.
+	// Across the splitter orientation it takes the role of the parent. All but the lowest child fold towards the top/left.
+	Splitter::Orientation nOrientation = pParent->getSplitOrientation();
+	size_t nIndex = pParent->getChildIndex(this);
+	bool bFirst = nIndex == 0;
+	bool bHi = nIndex + 1 < pParent->getChildCount();
 
-		if(
-			bRight &&
-			getParent()->getSplitter()->getOrientation() == Splitter::Vertical &&
-			isHiArea()
-		)
-			bRight = false;
+	m_nTouchedEdges = pParent->m_nTouchedEdges;
+	m_abHiArea[Splitter::Horizontal] = pParent->m_abHiArea[Splitter::Horizontal];
+	m_abHiArea[Splitter::Vertical] = pParent->m_abHiArea[Splitter::Vertical];
+	m_abHiArea[nOrientation] = bHi;
+
+	if(nOrientation == Splitter::Horizontal)
+	{
+		if(!bFirst)
+			m_nTouchedEdges &= ~EdgeTop;
+		if(bHi)
+			m_nTouchedEdges &= ~EdgeBottom;
+	}
+	else
+	{
+		if(!bFirst)
+			m_nTouchedEdges &= ~EdgeLeft;
+		if(bHi)
+			m_nTouchedEdges &= ~EdgeRight;
 	}
 }
 
+size_t Area::getChildIndex( Area const* pChild ) const
+{
+	return std::find(m_vChildren.begin(), m_vChildren.end(), pChild) - m_vChildren.begin();
+}
+
+/**
+ * Only areas which host a child layout need a window of their own, see Window.
+ * All other areas are geometry, the manager draws and hit-tests them for the managed window.
+ */
 void Area::CreateLayoutAreaWindow()
 {
 	// Create the Static Window
@@ -214,10 +259,14 @@ void Area::draw( HDC hDC )
 	if(m_bVisible == false)
 		return;
 
+	LAYOUT_TRACE_SCOPE_DETAIL("Area::draw", getName().c_str(), getDepth());
+
 	if(isParentArea())
 	{
-		m_pHiChild->draw(hDC);
-		m_pLoChild->draw(hDC);
+		for each(Area* pChild in m_vChildren)
+			pChild->draw(hDC);
+		for each(Splitter* pSplitter in m_vSplitters)
+			pSplitter->draw(hDC);
 	}
 	else
 	{
@@ -284,10 +333,12 @@ void Layout::Area::OnMouseLeave()
 		getManager()->getWnd()->ScreenToClient(&ptCursor);
 		// Only register area state as unhovered and redraw if the cursor is
 		// really not above the area anymore (Not just over a top control).
+		ptCursor.x += getManager()->getViewportOrigin().x;
+		ptCursor.y += getManager()->getViewportOrigin().y;
 		if(m_rctCurrentVisibleClientShape.PtInRect(ptCursor) == FALSE)
 		{
 			m_bHovered = false;
-			getManager()->getWnd()->InvalidateRect(&m_rctCurrentVisibleClientShape, TRUE);
+			invalidate(m_rctCurrentVisibleClientShape);
 			getManager()->setHoveredArea(NULL);
 		}
 	}
@@ -303,7 +354,20 @@ AreaStyles Area::getCurrentBkColorStyle() const
 		return (AreaStyles) FALSE;
 }
 
+void Area::invalidate( CRect const& rctLayout ) const
+{
+	// Layout coords differ from client coords once the viewport is scrolled
+	CRect rctClient(rctLayout);
+	rctClient.OffsetRect(-getManager()->getViewportOrigin());
+	::InvalidateRect(getManager()->getHwnd(), &rctClient, TRUE);
+}
+
 void Area::OnMouseMove( UINT nFlags, CPoint point )
+{
+	setHovered();
+}
+
+void Area::setHovered()
 {
 	if(hasStyle(AreaStyleHover))
 	{
@@ -311,7 +375,7 @@ void Area::OnMouseMove( UINT nFlags, CPoint point )
 		if(m_bHovered == false)
 		{
 			m_bHovered = true;
-			getManager()->getWnd()->InvalidateRect(&m_rctCurrentVisibleClientShape, TRUE);
+			invalidate(m_rctCurrentVisibleClientShape);
 			getManager()->setHoveredArea(this);
 		}
 
@@ -320,15 +384,17 @@ void Area::OnMouseMove( UINT nFlags, CPoint point )
 		// the mouse is still in the area, but windows assumes "leave" as not directly above the control.
 		// So we might have to generate a new TRACKMOUSEEVENT. We can determine that by querying
 		// if there's already one there.
+		// A windowless area receives the mouse messages of the managed window.
+		HWND hTrack = m_hWnd ? m_hWnd : getManager()->getHwnd();
 		TRACKMOUSEEVENT tme = {0};
 		tme.cbSize = sizeof(tme);
 		tme.dwFlags = TME_QUERY;
 		::TrackMouseEvent(&tme);
 
-		if(tme.hwndTrack != m_hWnd || (tme.dwFlags & TME_LEAVE) == 0)
+		if(tme.hwndTrack != hTrack || (tme.dwFlags & TME_LEAVE) == 0)
 		{
 			tme.dwFlags = TME_LEAVE;
-			tme.hwndTrack = m_hWnd;
+			tme.hwndTrack = hTrack;
 			::TrackMouseEvent(&tme);
 		}
 	}
@@ -341,6 +407,7 @@ void Area::OnMouseMove( UINT nFlags, CPoint point )
 Area::Area( Manager const* pMgr, CRect const& rctShape, SIZE const& hMinSize, SIZE const& hMaxSize ) :
 	m_hMinSize(hMinSize),
 	m_hMaxSize(hMaxSize),
+	m_bMinSizeStale(true),
 	m_hProcessedMinSize(NULLSIZE),
 	m_hFoldedMinSize(FOLDEDSIZE),
 	m_hProcessedFoldedMinSize(NULLSIZE),
@@ -349,22 +416,22 @@ Area::Area( Manager const* pMgr, CRect const& rctShape, SIZE const& hMinSize, SI
 	m_rctCurrentClientShape(0, 0, 0, 0),
 	m_pAlignmentManager(pMgr),
 	m_pParent(NULL),
-	m_pHiChild(NULL),
-	m_pLoChild(NULL),
-	m_pSplitter(NULL),
 	m_bHovered(false),
-	m_bVisible(true)
-
+	m_bVisible(true),
+	m_nTouchedEdges(EdgeAll),
+	m_bTracksStale(true)
 {
+	updateTopology();
 	setCurrentRect(rctShape);
 	updateProcessedFoldedMinSize();
 	m_rctOrigClientShape = getClientRect();
-	CreateLayoutAreaWindow();
+	updateRelativeScale();
 }
 
 Area::Area( Area const* pParent, CRect const& rctShape, SIZE const& hMinSize, SIZE const& hMaxSize ) :
 	m_hMinSize(hMinSize),
 	m_hMaxSize(hMaxSize),
+	m_bMinSizeStale(true),
 	m_hProcessedMinSize(NULLSIZE),
 	m_hFoldedMinSize(FOLDEDSIZE),
 	m_hProcessedFoldedMinSize(NULLSIZE),
@@ -373,48 +440,78 @@ Area::Area( Area const* pParent, CRect const& rctShape, SIZE const& hMinSize, SI
 	m_rctCurrentClientShape(0,0,0,0),
 	m_pAlignmentManager(pParent->getManager()),
 	m_pParent(pParent),
-	m_pHiChild(NULL),
-	m_pLoChild(NULL),
-	m_pSplitter(NULL),
 	m_bHovered(false),
-	m_bVisible(true)
+	m_bVisible(true),
+	m_nTouchedEdges(EdgeAll),
+	m_bTracksStale(true)
 {
+	updateTopology();
 	setCurrentRect(rctShape);
 	updateProcessedFoldedMinSize();
 	m_rctOrigClientShape = getClientRect();
-	CreateLayoutAreaWindow();
+	updateRelativeScale();
 }
 
 Area::~Area()
 {
-	if(isParentArea())
+	// Areas without manager are legal, see setCurrentRect()
+	Manager const* pManager = getManager();
+	if(pManager && pManager->m_pHitTestIndex)
+		pManager->m_pHitTestIndex->remove(HitTestIndex::Element(this));
+
+	for each(Area* pChild in m_vChildren)
+		delete pChild;
+	for each(Splitter* pSplitter in m_vSplitters)
+		delete pSplitter;
+}
+
+void Area::insertOwned( std::vector<Control*>& vControls )
+{
+	std::vector<Control*> vOwned;
+	std::vector<Control*>::iterator itKeep = vControls.begin();
+	for( std::vector<Control*>::iterator itCtrl = vControls.begin(); itCtrl != vControls.end(); ++itCtrl )
 	{
-		delete m_pLoChild;
-		delete m_pHiChild;
-		delete m_pSplitter;
+		if(isControlInRect(*itCtrl))
+			vOwned.push_back(*itCtrl);
+		else
+			*itKeep++ = *itCtrl;
 	}
+	vControls.erase(itKeep, vControls.end());
+
+	if(vOwned.empty())
+		return;
+
+	// Controls which straddle a splitter stay in this area
+	for each(Area* pChild in m_vChildren)
+	{
+		if(vOwned.empty())
+			break;
+		pChild->insertOwned(vOwned);
+	}
+
+	m_vControls.reserve(m_vControls.size() + vOwned.size());
+	for each(Control* pControl in vOwned)
+		attachControl(pControl);
 }
 
-bool Area::insertIfOwned( Control* pControl )
+void Area::attachControl( Control* pControl )
 {
-	bool bReturn = false;
+	getManager()->invalidateLayoutCache();
+	invalidateMinSize();
+	m_vControls.push_back(pControl);
+	pControl->setAlignmentArea(this);
+	getManager()->m_pHitTestIndex->update(HitTestIndex::Element(HitTestIndex::KindControl, pControl), pControl->getRect());
+}
 
-	if(isControlInRect(pControl))
+void Area::getLeafAreas( __out std::vector<Area*>& vLeafAreas )
+{
+	if(isParentArea())
 	{
-		// Insert the control into this alignment areas control list.
-		bReturn = true;
-		m_vControls.push_back(pControl);
-
-		if(isParentArea())
-		{
-			if(!m_pHiChild->insertIfOwned(pControl))
-				m_pLoChild->insertIfOwned(pControl);
-		}
-		else
-			pControl->setAlignmentArea(this);
+		for each(Area* pChild in m_vChildren)
+			pChild->getLeafAreas(vLeafAreas);
 	}
-
-	return bReturn;
+	else
+		vLeafAreas.push_back(this);
 }
 
 bool Area::clampRect(UINT nSide, CRect& rctNewrect)
@@ -492,8 +589,7 @@ void Area::update( CRect rctNewrect )
 	if(rctNewrect == m_rctCurrentShape)
 		return;
 	
-	if (m_hProcessedMinSize.cx == 0 && m_hProcessedMinSize.cy == 0)
-		updateMinSize();
+	updateMinSize();
 	
 	// Apply the new size
 	resizeAndAutoFoldIfNecessary(rctNewrect, true);
@@ -501,13 +597,15 @@ void Area::update( CRect rctNewrect )
 
 bool Area::isParentArea() const
 {
-	// This is a fundemental assertion. A binary tree can't be randomly linear.
-	AFXASSUME((m_pHiChild != NULL) == (m_pLoChild != NULL));
-	return m_pHiChild && m_pLoChild;
+	// This is a fundemental assertion. Each splitter lies between two children.
+	AFXASSUME(m_vChildren.empty() ? m_vSplitters.empty() : m_vChildren.size() == m_vSplitters.size() + 1);
+	return !m_vChildren.empty();
 }
 
 SIZE const& Area::getMinSize() const
 {
+	updateMinSize();
+
 	// If the area is foldable, its "official" minimum size
 	// is the folded size. The processed min size is just for the
 	// area to know when it should 'collapse'.
@@ -524,6 +622,8 @@ SIZE const& Area::getMaxSize() const
 
 void Area::resizeAndAutoFoldIfNecessary( __inout CRect& newShape, __in bool bShapeIsScreenCoords )
 {
+	LAYOUT_TRACE_SCOPE_DETAIL("Area::resizeAndAutoFoldIfNecessary", getName().c_str(), getDepth());
+
 	if(hasStyle(AreaStyleFoldable))
 	{
 		if(wouldFold(Splitter::Vertical, newShape.Size()))
@@ -545,8 +645,11 @@ void Area::resizeAndAutoFoldIfNecessary( __inout CRect& newShape, __in bool bSha
 	if(isParentArea())
 		updateSplitter();
 	else
+	{
+		LAYOUT_TIME_PHASE(getManager()->m_pPhaseClock, PhaseInvalidate);
 		// To prevent flickering, we only invalidate the background region for the 'bottommost' areas
-		::InvalidateRect(getManager()->getWnd()->GetSafeHwnd(), &m_rctCurrentClientShape, TRUE);
+		invalidate(m_rctCurrentClientShape);
+	}
 
 	updateControls();
 }
@@ -555,38 +658,64 @@ void Area::updateSplitter()
 {
 	// Ensure that this is a parent area with an updatable splitter
 	ASSERT(isParentArea());
+	LAYOUT_TIME_PHASE(getManager()->m_pPhaseClock, PhaseSplitter);
 
 	// Update the areas current rect to match the dialogs current position
 	updateCurrentRect();
 
-	// Update the splitter as an aligned control
-	m_pSplitter->update();
+	// With more than one splitter, all of them are aligned first. The min size check of
+	// each splitter then sees its neighbours at their new position, and corrects them in one sweep.
+	if(m_vSplitters.size() > 1)
+	{
+		for each(Splitter* pSplitter in m_vSplitters)
+			pSplitter->alignRect();
+	}
+
+	// Update the splitters as aligned controls
+	for each(Splitter* pSplitter in m_vSplitters)
+		pSplitter->update();
 
 	// Update the child areas according to the splitters new position
 	updateChildAreas();
 }
 
+void Area::invalidateMinSize() const
+{
+	// The auto tracks depend on the same controls as the min size
+	m_bTracksStale = true;
+
+	// A stale area has stale ancestors already
+	for(Area const* pArea = this; pArea && !pArea->m_bMinSizeStale; pArea = pArea->m_pParent)
+		pArea->m_bMinSizeStale = true;
+}
+
 void Area::updateMinSize() const
 {
 	using namespace boost::icl;
+	if(!m_bMinSizeStale)
+		return;
+
+	++getManager()->m_aPassCounters.nMinSized;
+	LAYOUT_TIME_PHASE(getManager()->m_pPhaseClock, PhaseMinSize);
 	
-	// Get the min size of the children
+	m_hProcessedMinSize.cx = m_hProcessedMinSize.cy = 0;
+
+	// Get the min size of the children in one pass:
+	// The largest one across the splitters, the sum along them
 	if(isParentArea())
 	{
-		getChildHi()->updateMinSize();
-		getChildLo()->updateMinSize();
-
-		long* minSizeHi = (long*) &(getChildHi()->getMinSize());
-		long* minSizeLo = (long*) &(getChildLo()->getMinSize());
-
-		const int iFixedDim = m_pSplitter->getOrientation();
+		const int iFixedDim = getSplitOrientation();
 		const int iSplitDim = 1 - iFixedDim;
 
 		assert(iFixedDim >= 0 && iFixedDim <= 1);
 
 		long* plResult = (long*) &m_hProcessedMinSize;
-		plResult[iFixedDim] = std::max(minSizeHi[iFixedDim], minSizeLo[iFixedDim]);
-		plResult[iSplitDim] = minSizeHi[iSplitDim] + minSizeLo[iSplitDim];
+		for each(Area const* pChild in m_vChildren)
+		{
+			long const* plChild = (long const*) &(pChild->getMinSize());
+			plResult[iFixedDim] = std::max(plResult[iFixedDim], plChild[iFixedDim]);
+			plResult[iSplitDim] += plChild[iSplitDim];
+		}
 	}
 	if (m_hMinSize.cy == 0 || m_hMinSize.cx == 0)
 	{
@@ -606,13 +735,16 @@ void Area::updateMinSize() const
 		bottomInset += std::make_pair(interval<int>::right_open(
 			area.left, area.right), MaxDistance(defaultPadding));
 		
+		// The controls of a folded area are hidden by the fold, they still count for when it unfolds
+		bool bFolded = isFolded(Splitter::Horizontal) || isFolded(Splitter::Vertical);
+
 		// Calculate the min size of the fixed-size controls. (Controls with high or low alignment)
 		// Since Parent areas can also hold controls, it would be more correct to calculate
 		// the minimum required size also for those. #MaybeLater
 		for each(Control const* pAlignedControl in m_vControls)
 		{
 			CRect inset(0, 0, 0, 0);
-			pAlignedControl->getMinInsets(inset);
+			pAlignedControl->getMinInsets(inset, bFolded);
 			
 			CRect controlFrame = pAlignedControl->getOrigRect();
 			
@@ -626,8 +758,17 @@ void Area::updateMinSize() const
 				controlFrame.left, controlFrame.right), MaxDistance(inset.bottom));
 		}
 		
-		m_hProcessedMinSize.cx = CalcMinSize(leftOffset, rightInset);
-		m_hProcessedMinSize.cy = CalcMinSize(topOffset, bottomInset);
+		// The own controls of a parent area, e.g. straddling a splitter, add to what its children need
+		m_hProcessedMinSize.cx = std::max(m_hProcessedMinSize.cx, (LONG) CalcMinSize(leftOffset, rightInset));
+		m_hProcessedMinSize.cy = std::max(m_hProcessedMinSize.cy, (LONG) CalcMinSize(topOffset, bottomInset));
+	}
+
+	// A grid needs at least the sum of its tracks
+	if(!m_aTracks[Align::Horizontal].empty() || !m_aTracks[Align::Vertical].empty())
+	{
+		fitTracks();
+		m_hProcessedMinSize.cx = std::max(m_hProcessedMinSize.cx, (LONG) m_aTracks[Align::Horizontal].getMinSize());
+		m_hProcessedMinSize.cy = std::max(m_hProcessedMinSize.cy, (LONG) m_aTracks[Align::Vertical].getMinSize());
 	}
 
 	// Check if a min size is set for this area,
@@ -640,70 +781,104 @@ void Area::updateMinSize() const
 		if(m_hProcessedMinSize.cy < m_hMinSize.cy)
 			m_hProcessedMinSize.cy = m_hMinSize.cy;
 	}
-}
-
-void Area::getChildAreaShapes( __out CRect& rctHi, __out CRect& rctLo ) const
-{
-	if(!m_pSplitter)
-		return;
 
-	getChildAreaShapes(rctHi, rctLo, m_pSplitter->getRect());
+	m_bMinSizeStale = false;
 }
 
-void Area::getChildAreaShapes( __out CRect& rctHi, __out CRect& rctLo, __in CRect const& rctSplitter, __in bool bSplitterRectIsScreenCoords ) const
+void Area::getChildAreaShapes( __in size_t nSplitter, __out CRect& rctHi, __out CRect& rctLo, __in CRect const& rctSplitter, __in bool bSplitterRectIsScreenCoords ) const
 {
-	if(!m_pSplitter)
+	if(nSplitter >= m_vSplitters.size())
 		return;
 
 	CRect rctSplitterScreenRect = rctSplitter;
 	if(bSplitterRectIsScreenCoords == false)
 		getManager()->getWnd()->ClientToScreen(rctSplitterScreenRect);
 
-	switch(m_pSplitter->getOrientation())
-	{
-		case 0: // horizontal splitter
-		{
-			rctHi.bottom = rctSplitterScreenRect.top;
-			rctHi.right = m_rctCurrentShape.right;
-			rctLo.top = rctSplitterScreenRect.bottom;
-			rctLo.left = m_rctCurrentShape.left;
-			break;
-		}
-		case 1: // vertical splitter
-		{
-			rctHi.bottom = m_rctCurrentShape.bottom;
-			rctHi.right = rctSplitterScreenRect.left;
-			rctLo.top = m_rctCurrentShape.top;
-			rctLo.left = rctSplitterScreenRect.right;
-		}
-	}
+	// The children next to the splitter end at the neighbouring splitters, or at the edges of this area
+	CRect rctBefore, rctAfter;
+	if(nSplitter > 0)
+		getSplitterScreenRect(nSplitter - 1, rctBefore);
+	if(nSplitter + 1 < m_vSplitters.size())
+		getSplitterScreenRect(nSplitter + 1, rctAfter);
 
-	rctHi.top = m_rctCurrentShape.top;
-	rctHi.left = m_rctCurrentShape.left;
-	rctLo.bottom = m_rctCurrentShape.bottom;
-	rctLo.right = m_rctCurrentShape.right;
+	Splitter::Orientation nOrientation = getSplitOrientation();
+	GetShapeBetween(m_rctCurrentShape, nOrientation, nSplitter > 0 ? &rctBefore : NULL, &rctSplitterScreenRect, rctHi);
+	GetShapeBetween(m_rctCurrentShape, nOrientation, &rctSplitterScreenRect, nSplitter + 1 < m_vSplitters.size() ? &rctAfter : NULL, rctLo);
+}
+
+void Area::getSplitterScreenRect( __in size_t nSplitter, __out CRect& rctSplitter ) const
+{
+	rctSplitter = m_vSplitters[nSplitter]->getRect();
+	getManager()->getWnd()->ClientToScreen(rctSplitter);
 }
 
 void Area::updateControls()
 {
-	HDWP windowPosHandle = BeginDeferWindowPos(m_vControls.size());
+	Manager* pManager = const_cast<Manager*>(getManager());
+
+	CRect rctVisible;
+	if (pManager)
+		pManager->getViewportRect(rctVisible);
+
+	// Size the tracks once, the controls within them only look up the edges
+	layoutTracks();
+
 	for each(Control* pControl in m_vControls)
-		if (!(windowPosHandle = pControl->update(windowPosHandle)))
-			break;
+		pControl->align();
+
+	HDWP windowPosHandle = applyControls(BeginDeferWindowPos(m_vControls.size()), rctVisible);
 	if (windowPosHandle)
+	{
+		LAYOUT_TIME_PHASE(pManager->m_pPhaseClock, PhaseApply);
 		EndDeferWindowPos(windowPosHandle);
+	}
+
+	updateVirtualControls(rctVisible);
+}
+
+HDWP Area::applyControls( HDWP windowPosHandle, CRect const& rctVisible )
+{
+	Manager* pManager = const_cast<Manager*>(getManager());
+
+	// In viewport mode, the windows of controls out of view are not moved until they are scrolled into view
+	bool bViewportMode = pManager && pManager->isViewportMode();
+	for each(Control* pControl in m_vControls)
+	{
+		CRect rctIntersection;
+		if (bViewportMode && !pControl->isVirtual() && !rctIntersection.IntersectRect(&pControl->m_rctCurrent, &rctVisible))
+			pManager->deferControl(pControl);
+		else if (!(windowPosHandle = pControl->apply(windowPosHandle)))
+			break;
+	}
+	return windowPosHandle;
+}
+
+void Area::updateVirtualControls( CRect const& rctVisible )
+{
+	Manager* pManager = const_cast<Manager*>(getManager());
+
+	// Virtual controls get a window only while they are within the viewport
+	if (pManager && !pManager->m_vVirtualControls.empty())
+	{
+		for each(Control* pControl in m_vControls)
+			if (pControl->isVirtual())
+				pManager->updateVirtualControl(pControl, rctVisible);
+	}
 }
 
 bool Area::removeControl( Control* pCtrl )
 {
-	for( std::vector<Control*>::iterator itCtrl = m_vControls.begin(); itCtrl != m_vControls.end(); ++itCtrl )
-		if(*itCtrl == pCtrl)
-		{
-			m_vControls.erase(itCtrl);
-			return true;
-		}
+	std::vector<Control*>::iterator itCtrl = std::find(m_vControls.begin(), m_vControls.end(), pCtrl);
+	if(itCtrl == m_vControls.end())
+		return false;
 
-	return false;
+	getManager()->invalidateLayoutCache();
+	invalidateMinSize();
+
+	// The order of the controls is irrelevant, so the gap is filled with the last one
+	*itCtrl = m_vControls.back();
+	m_vControls.pop_back();
+	return true;
 }
 
 Splitter const* Area::putSplitter( Control const* pHigh, Control const* pLow, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment )
@@ -716,34 +891,123 @@ Splitter const* Area::putSplitter( Control const* pHigh, Control const* pLow, Sp
 	// Create the Splitter
 	CRect rctSplitter(0, 0, 0, 0);
 	getSplitterRect(nOrientation, rctSplitter, pHigh, pLow);
-	m_pSplitter = Splitter::Create(this, rctSplitter, nOrientation, nAlignment);
+
+	// Splitting a child of a parent split the same way adds a child to the parent.
+	// This keeps rows and columns of many areas one level deep, instead of a chain of binary splits.
+	if(canJoinParent(nOrientation, rctSplitter))
+		return const_cast<Area*>(m_pParent)->splitChild(this, rctSplitter, nAlignment);
+
+	getManager()->invalidateLayoutCache();
+	invalidateMinSize();
+
+	m_vSplitters.push_back(Splitter::Create(this, rctSplitter, nOrientation, nAlignment));
 
 	// Create the child areas
 	CRect rctHi, rctLo;
-	getChildAreaShapes(rctHi, rctLo, rctSplitter);
-	m_pHiChild = new Area(this, rctHi, NULLSIZE, NULLSIZE);
-	m_pLoChild = new Area(this, rctLo, NULLSIZE, NULLSIZE);
+	getChildAreaShapes(0, rctHi, rctLo, rctSplitter);
+	m_vChildren.push_back(new Area(this, rctHi, NULLSIZE, NULLSIZE));
+	m_vChildren.push_back(new Area(this, rctLo, NULLSIZE, NULLSIZE));
+	Area* pHiChild = m_vChildren.front();
+	Area* pLoChild = m_vChildren.back();
+
+	// While being constructed, the hi child could not know its role yet
+	pHiChild->updateTopology();
+	pHiChild->setCurrentRect(rctHi);
+	pHiChild->updateProcessedFoldedMinSize();
+
+	// Distribute the controls onto the child areas in one pass.
+	// Controls which straddle the splitter stay in this area.
+	std::vector<Control*>::iterator itKeep = m_vControls.begin();
+	for( std::vector<Control*>::iterator itCtrl = m_vControls.begin(); itCtrl != m_vControls.end(); ++itCtrl )
+	{
+		if(pHiChild->isControlInRect(*itCtrl))
+			pHiChild->attachControl(*itCtrl);
+		else if(pLoChild->isControlInRect(*itCtrl))
+			pLoChild->attachControl(*itCtrl);
+		else
+			*itKeep++ = *itCtrl;
+	}
+	m_vControls.erase(itKeep, m_vControls.end());
 
-	std::list<Control*> lstMovedToChildList;
+	// This area is no leaf anymore, it is covered by its children and the splitter
+	getManager()->m_pHitTestIndex->remove(HitTestIndex::Element(this));
 
-	// Insert the controls into the child areas
-	for each(Control* pCtrl in m_vControls)
-	{
-		if(!m_pHiChild->insertIfOwned(pCtrl))
-			m_pLoChild->insertIfOwned(pCtrl);
+	// Hide this control. Only the bottom level area controls need to be "visible"
+	if(GetSafeHwnd() != NULL)
+		ShowWindow(SW_HIDE);
+
+	return m_vSplitters.front();
+}
+
+bool Area::canJoinParent( Splitter::Orientation nOrientation, CRect const& rctSplitter ) const
+{
+	if(!m_pParent || m_pParent->getSplitOrientation() != nOrientation || GetSafeHwnd() != NULL)
+		return false;
+
+	// The own properties of this area would only apply to the higher part afterwards
+	if(CSize(m_hMinSize) != CSize(NULLSIZE) || CSize(m_hMaxSize) != CSize(NULLSIZE) || getStyle() != 0 || !getName().empty())
+		return false;
+
+	if(!m_bVisible || isFolded(Splitter::Horizontal) || isFolded(Splitter::Vertical))
+		return false;
 
-		if(pCtrl->getArea() == m_pHiChild || pCtrl->getArea() == m_pLoChild)
-			lstMovedToChildList.push_back(pCtrl);
+	// A control straddling the splitter would have no area left to stay in
+	CRect rctHi, rctLo;
+	GetShapeBetween(m_rctCurrentClientShape, nOrientation, NULL, &rctSplitter, rctHi);
+	GetShapeBetween(m_rctCurrentClientShape, nOrientation, &rctSplitter, NULL, rctLo);
+	for each(Control const* pControl in m_vControls)
+	{
+		if(!ContainsControl(rctHi, pControl) && !ContainsControl(rctLo, pControl))
+			return false;
 	}
+	return true;
+}
+
+Splitter const* Area::splitChild( Area* pChild, CRect const& rctSplitter, Splitter::SplitterAlignment nAlignment )
+{
+	size_t nChild = getChildIndex(pChild);
+	ASSERT(nChild < m_vChildren.size());
+	if(nChild >= m_vChildren.size())
+		return NULL;
 
-	// Remove all controls from this areas list that have been moved to child lists
-	for each(Control* pCtrl in lstMovedToChildList)
-		removeControl(pCtrl);
+	getManager()->invalidateLayoutCache();
+	pChild->invalidateMinSize();
 
-	// Hide this control. Only the bottom level area controls need to be "visible"
-	ShowWindow(SW_HIDE);
+	// The new splitter comes after the child, the splitters behind it move up one position
+	Splitter* pSplitter = Splitter::Create(this, rctSplitter, getSplitOrientation(), nAlignment);
+	m_vSplitters.insert(m_vSplitters.begin() + nChild, pSplitter);
+	for(size_t nIndex = nChild; nIndex < m_vSplitters.size(); ++nIndex)
+		m_vSplitters[nIndex]->m_nIndex = nIndex;
 
-	return m_pSplitter;
+	CRect rctHi, rctLo;
+	getChildAreaShapes(nChild, rctHi, rctLo, rctSplitter);
+	Area* pLoChild = new Area(this, rctLo, NULLSIZE, NULLSIZE);
+	m_vChildren.insert(m_vChildren.begin() + nChild + 1, pLoChild);
+
+	// Both children know their position only now. The child is smaller from now on,
+	// its orig rect starts over like the one of a new child.
+	pChild->updateTopology();
+	pChild->setCurrentRect(rctHi);
+	pChild->updateProcessedFoldedMinSize();
+	pChild->m_rctOrigClientShape = pChild->getClientRect();
+	pChild->updateRelativeScale();
+	pLoChild->updateTopology();
+	pLoChild->setCurrentRect(rctLo);
+	pLoChild->updateProcessedFoldedMinSize();
+
+	// Move the controls of the lower part, see canJoinParent()
+	std::vector<Control*>& vControls = pChild->m_vControls;
+	std::vector<Control*>::iterator itKeep = vControls.begin();
+	for( std::vector<Control*>::iterator itCtrl = vControls.begin(); itCtrl != vControls.end(); ++itCtrl )
+	{
+		if(pLoChild->isControlInRect(*itCtrl))
+			pLoChild->attachControl(*itCtrl);
+		else
+			*itKeep++ = *itCtrl;
+	}
+	vControls.erase(itKeep, vControls.end());
+
+	return pSplitter;
 }
 
 void Area::getSplitterRect( Splitter::Orientation nOrientation, __out CRect& rctSplitter, Control const* pHigh, Control const* pLow )
@@ -789,8 +1053,7 @@ void Area::getSplitterRect( Splitter::Orientation nOrientation, __out CRect& rct
 
 bool Area::isControlInRect( Control const* pCtrl )
 {
-	CRect const& rctClient = getClientRect();
-	return rctClient.PtInRect(pCtrl->getRect().TopLeft()) && rctClient.PtInRect(pCtrl->getRect().BottomRight());
+	return ContainsControl(getClientRect(), pCtrl);
 }
 
 bool Area::hasMinMaxSize() const
@@ -811,16 +1074,22 @@ void Area::setCurrentRect( CRect const& rctShape, bool bShapeIsScreenCoords )
 	else
 		getManager()->getWnd()->ClientToScreen(m_rctCurrentShape);
 
+	updateRelativeScale();
+
 	m_rctCurrentVisibleClientShape = getVisibleClientRect();
 	m_rctCurrentVisibleShape = m_rctCurrentVisibleClientShape;
 	getManager()->getWnd()->ClientToScreen(&m_rctCurrentVisibleShape);
 
+	if(!isParentArea())
+		getManager()->m_pHitTestIndex->update(HitTestIndex::Element(this), m_rctCurrentClientShape);
+
 	if(GetSafeHwnd() != NULL)
 	{
+		CPoint const& ptOrigin = getManager()->getViewportOrigin();
 		SetWindowPos(
 			&wndBottom,
-			m_rctCurrentClientShape.left,
-			m_rctCurrentClientShape.top,
+			m_rctCurrentClientShape.left - ptOrigin.x,
+			m_rctCurrentClientShape.top - ptOrigin.y,
 			m_rctCurrentClientShape.Width(),
 			m_rctCurrentClientShape.Height(),
 			SWP_NOACTIVATE
@@ -828,16 +1097,75 @@ void Area::setCurrentRect( CRect const& rctShape, bool bShapeIsScreenCoords )
 	}
 }
 
-void Area::updateChildAreas()
+void Area::updateRelativeScale()
 {
-	// Retreive the new child area shapes
-	CRect rctHi, rctLo;
+	int aiOrig[2] = {m_rctOrigClientShape.Width(), m_rctOrigClientShape.Height()};
+	int aiCurrent[2] = {m_rctCurrentClientShape.Width(), m_rctCurrentClientShape.Height()};
+
+	// Rounded to nearest, an unchanged size gives exactly 1.0
+	for(int i = 0; i < 2; ++i)
+		m_aiRelativeScale[i] = aiOrig[i] > 0 ? (boost::int32_t) ((((boost::int64_t) aiCurrent[i] << 16) + aiOrig[i] / 2) / aiOrig[i]) : 1 << 16;
+}
 
-	getChildAreaShapes(rctHi, rctLo);
+void Area::setTracks( Align::Dimension nDim, Tracks const& aTracks )
+{
+	getManager()->invalidateLayoutCache();
+	m_aTracks[nDim] = aTracks;
+	invalidateMinSize();
+}
+
+void Area::fitTracks() const
+{
+	if(!m_bTracksStale)
+		return;
+
+	m_aTracks[Align::Horizontal].resetContent();
+	m_aTracks[Align::Vertical].resetContent();
+
+	// Like for the min size, the controls of a folded area count if they were shown before
+	bool bFolded = isFolded(Splitter::Horizontal) || isFolded(Splitter::Vertical);
+	for each(Control const* pControl in m_vControls)
+	{
+		if(!pControl->countsForMinSize(bFolded))
+			continue;
+
+		CRect const& rctOrig = pControl->getOrigRect();
+		if(pControl->m_aHorzAlign.nKind == Align::KindTrack)
+			m_aTracks[Align::Horizontal].fitContent(Align::Track::index(pControl->m_aHorzAlign.iParam), Align::Track::span(pControl->m_aHorzAlign.iParam), rctOrig.Width());
+		if(pControl->m_aVertAlign.nKind == Align::KindTrack)
+			m_aTracks[Align::Vertical].fitContent(Align::Track::index(pControl->m_aVertAlign.iParam), Align::Track::span(pControl->m_aVertAlign.iParam), rctOrig.Height());
+	}
+
+	m_bTracksStale = false;
+}
+
+void Area::layoutTracks()
+{
+	if(m_aTracks[Align::Horizontal].empty() && m_aTracks[Align::Vertical].empty())
+		return;
+
+	fitTracks();
+	if(!m_aTracks[Align::Horizontal].empty())
+		m_aTracks[Align::Horizontal].layout(m_rctCurrentClientShape.left, m_rctCurrentClientShape.Width());
+	if(!m_aTracks[Align::Vertical].empty())
+		m_aTracks[Align::Vertical].layout(m_rctCurrentClientShape.top, m_rctCurrentClientShape.Height());
+}
+
+void Area::updateChildAreas()
+{
+	// Retreive the new child area shapes: each child lies between the splitters next to it
+	std::vector<CRect> vSplitters(m_vSplitters.size());
+	for(size_t nSplitter = 0; nSplitter < m_vSplitters.size(); ++nSplitter)
+		getSplitterScreenRect(nSplitter, vSplitters[nSplitter]);
 
 	// Apply the new shapes
-	m_pHiChild->resizeAndAutoFoldIfNecessary(rctHi, true);
-	m_pLoChild->resizeAndAutoFoldIfNecessary(rctLo, true);
+	Splitter::Orientation nOrientation = getSplitOrientation();
+	for(size_t nChild = 0; nChild < m_vChildren.size(); ++nChild)
+	{
+		CRect rctChild;
+		GetShapeBetween(m_rctCurrentShape, nOrientation, nChild > 0 ? &vSplitters[nChild - 1] : NULL, nChild < vSplitters.size() ? &vSplitters[nChild] : NULL, rctChild);
+		m_vChildren[nChild]->resizeAndAutoFoldIfNecessary(rctChild, true);
+	}
 }
 
 void Area::updateCurrentRect()
@@ -848,36 +1176,57 @@ void Area::updateCurrentRect()
 
 void Area::updateOrigRect()
 {
+	getManager()->invalidateLayoutCache();
+	invalidateMinSize();
 	updateCurrentRect();
 	m_rctOrigClientShape = m_rctCurrentClientShape;
+	updateRelativeScale();
 
-	if(isParentArea())
-	{
-		m_pHiChild->updateOrigRect();
-		m_pLoChild->updateOrigRect();
-		m_pSplitter->updateOrigRect();
-	}
+	for each(Area* pChild in m_vChildren)
+		pChild->updateOrigRect();
+	for each(Splitter* pSplitter in m_vSplitters)
+		pSplitter->updateOrigRect();
 
 	for each(Control* pCtrl in m_vControls)
 		pCtrl->updateOrigRect();
 }
 
-bool Area::checkSplitterRectWithChildAreaMinSizesAndAutoFold( __inout CRect& rctSplitter ) const
+void Area::rebaseOrigRect()
+{
+	getManager()->invalidateLayoutCache();
+	invalidateMinSize();
+	m_rctOrigClientShape = m_rctCurrentClientShape;
+	updateRelativeScale();
+
+	for each(Area* pChild in m_vChildren)
+		pChild->rebaseOrigRect();
+	for each(Splitter* pSplitter in m_vSplitters)
+		pSplitter->rebaseOrigRect();
+
+	for each(Control* pCtrl in m_vControls)
+		pCtrl->rebaseOrigRect();
+}
+
+bool Area::checkSplitterRectWithChildAreaMinSizesAndAutoFold( __in size_t nSplitter, __inout CRect& rctSplitter ) const
 {
 	LONG* plSplitterRect = (LONG*) &rctSplitter; // {x1, y1, x2, y2}
 
-	// Check if the given splitter rect would violate the child areas min sizes
+	// Check if the given splitter rect would violate the min sizes of the children next to it
 	CRect rctHi, rctLo;
-	getChildAreaShapes(rctHi, rctLo, rctSplitter, false);
+	getChildAreaShapes(nSplitter, rctHi, rctLo, rctSplitter, false);
+
+	Splitter const* pSplitter = m_vSplitters[nSplitter];
+	Area const* pChildHi = m_vChildren[nSplitter];
+	Area const* pChildLo = m_vChildren[nSplitter + 1];
 
-	int iFixedDim = (int) m_pSplitter->getOrientation();
-	int iSplitDim = 1 - m_pSplitter->getOrientation();
+	int iFixedDim = (int) pSplitter->getOrientation();
+	int iSplitDim = 1 - pSplitter->getOrientation();
 
 	SIZE currentSizeLo(rctLo.Size()), currentSizeHi(rctHi.Size());
 	LONG const* plLoCurrentSize = (LONG*) &currentSizeLo;
 	LONG const* plHiCurrentSize = (LONG*) &currentSizeHi;
-	LONG const* plLoMinSize = (LONG*) &(getChildLo()->getMinSize());
-	LONG const* plHiMinSize = (LONG*) &(getChildHi()->getMinSize());
+	LONG const* plLoMinSize = (LONG*) &(pChildLo->getMinSize());
+	LONG const* plHiMinSize = (LONG*) &(pChildHi->getMinSize());
 
 	bool bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit = false;
 
@@ -891,7 +1240,7 @@ bool Area::checkSplitterRectWithChildAreaMinSizesAndAutoFold( __inout CRect& rct
 		// might lead to the higher area collapsing. Thats why we will only dis-
 		// able the folding check if the splitter is already folded for this area.
 		// A splitter can not fold towards the high and the low area at the same time.
-		bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit = getChildLo()->hasStyle(AreaStyleFoldable);
+		bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit = pChildLo->hasStyle(AreaStyleFoldable);
 	}
 	else if(plHiCurrentSize[iSplitDim] < plHiMinSize[iSplitDim])
 	{
@@ -903,18 +1252,18 @@ bool Area::checkSplitterRectWithChildAreaMinSizesAndAutoFold( __inout CRect& rct
 		// might lead to the lower area collapsing. Thats why we will only dis-
 		// able the folding check if the splitter is already folded for this area.
 		// A splitter can not fold towards the high and the low area at the same time.
-		bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit = getChildHi()->hasStyle(AreaStyleFoldable);
+		bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit = pChildHi->hasStyle(AreaStyleFoldable);
 	}
 
 	bool bResult = bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit;
 
 	// If the user let go of the splitter, and one of the areas collapsed or would collapse,
 	// then we will pull the splitter to the edge of the collapsed area
-	if(getSplitter()->isDraggedByUser() == false && bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit == false)
+	if(pSplitter->isDraggedByUser() == false && bFoldingCheckNotNeededSinceSplitterAlreadyAtLimit == false)
 	{
 		if(
-			getChildHi()->isFolded(getSplitter()->getOrientation()) ||
-			getChildHi()->wouldFold(getSplitter()->getOrientation(), currentSizeHi)
+			pChildHi->isFolded(pSplitter->getOrientation()) ||
+			pChildHi->wouldFold(pSplitter->getOrientation(), currentSizeHi)
 		)
 		{
 			int iDiff = plHiCurrentSize[iSplitDim] - plHiMinSize[iSplitDim];
@@ -923,8 +1272,8 @@ bool Area::checkSplitterRectWithChildAreaMinSizesAndAutoFold( __inout CRect& rct
 			bResult = true;
 		}
 		else if(
-			getChildLo()->isFolded(getSplitter()->getOrientation()) ||
-			getChildLo()->wouldFold(getSplitter()->getOrientation(), currentSizeLo)
+			pChildLo->isFolded(pSplitter->getOrientation()) ||
+			pChildLo->wouldFold(pSplitter->getOrientation(), currentSizeLo)
 		)
 		{
 			int iDiff = plLoCurrentSize[iSplitDim] - plLoMinSize[iSplitDim];
@@ -940,6 +1289,7 @@ void Area::fold(Splitter::Orientation nOrientation)
 {
 	if(!m_mapDimensionFolded[nOrientation])
 	{
+		LAYOUT_TRACE_SCOPE_DETAIL("Area::fold", getName().c_str(), getDepth());
 		m_mapDimensionFolded[nOrientation] = true;
 
 		getFoldedShape(nOrientation, m_rctCurrentShape);
@@ -948,15 +1298,21 @@ void Area::fold(Splitter::Orientation nOrientation)
 		for each(Control* pControl in m_vControls)
 			pControl->temporaryHide();
 
-		if(isParentArea())
-			m_pSplitter->temporaryHide();
+		for each(Splitter* pSplitter in m_vSplitters)
+		{
+			pSplitter->temporaryHide();
+			pSplitter->invalidate(pSplitter->getRect());
+		}
 
+		// The windows are hidden by updateControls() in the batch that moves them
 		resizeAndAutoFoldIfNecessary(m_rctCurrentShape);
 	}
 }
 
 void Area::unfold(__in CRect const& rctDesiredUnfoldedShape)
 {
+	LAYOUT_TRACE_SCOPE_DETAIL("Area::unfold", getName().c_str(), getDepth());
+
 	// Mark as unfolded
 	m_mapDimensionFolded[Splitter::Horizontal] = false;
 	m_mapDimensionFolded[Splitter::Vertical] = false;
@@ -965,8 +1321,11 @@ void Area::unfold(__in CRect const& rctDesiredUnfoldedShape)
 	for each(Control* pControl in m_vControls)
 		pControl->temporaryShow();
 
-	if(isParentArea())
-		m_pSplitter->temporaryShow();
+	for each(Splitter* pSplitter in m_vSplitters)
+	{
+		pSplitter->temporaryShow();
+		pSplitter->invalidate(pSplitter->getRect());
+	}
 
 	resizeAndAutoFoldIfNecessary(CRect(rctDesiredUnfoldedShape));
 }
@@ -976,6 +1335,7 @@ bool Area::wouldFold( Splitter::Orientation nDim, SIZE szTestSize ) const
 	if(!hasStyle(AreaStyleFoldable))
 		return false;
 
+	updateMinSize();
 	if(nDim == Splitter::Vertical && szTestSize.cx < m_hProcessedMinSize.cx)
 		return true;
 
@@ -1005,30 +1365,52 @@ bool Area::isFolded( Splitter::Orientation nDim ) const
 
 void Area::setVisible( bool bShow )
 {
-	if(bShow)
+	getManager()->invalidateLayoutCache();
+
+	// Mark the whole subtree first, then show or hide all windows in one batch
+	Manager* pManager = const_cast<Manager*>(getManager());
+	if (pManager->isInTransaction())
 	{
-		// Hide Controls if not collapsed already
-		if(!isFolded(Splitter::Horizontal) && !isFolded(Splitter::Vertical))
-			for each(Control* pControl in m_vControls)
-				pControl->temporaryHide();
+		markVisible(bShow, pManager->m_vTransactionControls);
+		return;
 	}
-	else
+
+	std::vector<Control*> vControls;
+	markVisible(bShow, vControls);
+	pManager->applyVisibility(vControls);
+}
+
+void Area::markVisible( bool bShow, __inout std::vector<Control*>& vControls )
+{
+	// Controls of a folded area are hidden already and stay so
+	if(m_bVisible != bShow && !isFolded(Splitter::Horizontal) && !isFolded(Splitter::Vertical))
 	{
-		// Show controls if not hidden due to collapse
-		if(!isFolded(Splitter::Horizontal) && !isFolded(Splitter::Vertical))
-			for each(Control* pControl in m_vControls)
+		for each(Control* pControl in m_vControls)
+		{
+			if(bShow)
 				pControl->temporaryShow();
+			else
+				pControl->temporaryHide();
+		}
+		vControls.insert(vControls.end(), m_vControls.begin(), m_vControls.end());
+		invalidateMinSize();
+
+		// The splitters have no window to show or hide
+		for each(Splitter* pSplitter in m_vSplitters)
+		{
+			if(bShow)
+				pSplitter->temporaryShow();
+			else
+				pSplitter->temporaryHide();
+			pSplitter->invalidate(pSplitter->getRect());
+		}
 	}
 
 	m_bVisible = bShow;
 
 	// Propagate visiblity to subareas
-	if(isParentArea())
-	{
-		m_pHiChild->setVisible(bShow);
-		m_pLoChild->setVisible(bShow);
-		m_pSplitter->ShowWindow(bShow ? SW_SHOW : SW_HIDE);
-	}
+	for each(Area* pChild in m_vChildren)
+		pChild->markVisible(bShow, vControls);
 }
 
 bool Area::isLoArea() const
@@ -1046,18 +1428,12 @@ bool Area::isHiArea() const
 	if(!getParent())
 		return true;
 
-	return getParent()->getChildHi() == this;
+	return getParent()->getChildLo() != this;
 }
 
 bool Area::isHiArea(Splitter::Orientation nOrientation) const
 {
-	if(!getParent())
-		return true;
-
-	if(getParent()->getSplitter()->getOrientation() == nOrientation)
-		return isHiArea();
-	else
-		return getParent()->isHiArea(nOrientation);
+	return m_abHiArea[nOrientation];
 }
 
 void Area::getFoldedShape( __in Splitter::Orientation nOrientation, __inout CRect& rctShape )
@@ -1077,20 +1453,3 @@ void Area::getFoldedShape( __in Splitter::Orientation nOrientation, __inout CRec
 			rctShape.left = rctShape.right - m_hProcessedFoldedMinSize.cx;
 	}
 }
-
-Area* Layout::Area::isBackgroundHwnd(HWND hCtrl)
-{
-	if(hCtrl == GetSafeHwnd())
-		return this;
-
-	if(isParentArea())
-	{
-		Area* pResult = m_pHiChild->isBackgroundHwnd(hCtrl);
-		if(pResult != NULL)
-			return pResult;
-		else if(pResult = m_pLoChild->isBackgroundHwnd(hCtrl))
-			return pResult;
-	}
-
-	return NULL;
-}
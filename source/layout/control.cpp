@@ -4,6 +4,7 @@
 #include "../../GlobExport/manager.h"
 #include "../../GlobExport/area.h"
 #include "../../GlobExport/control.h"
+#include "../../GlobExport/instrumentation.h"
 
 using namespace Layout;
 
@@ -15,17 +16,108 @@ Control::Control( Manager const* pMgr, HWND hCtrl, Align::Mode& hAlignHorz, Alig
 	m_pAlignmentArea(NULL),
 	m_pManager(NULL),
 	m_bVisibilityBeforeTempHide(FALSE),
-	m_sName(sName)
+	m_sName(sName),
+	m_bVirtual(false),
+	m_bVirtualHidden(false),
+	m_nKey(0),
+	m_bLayoutPending(false),
+	m_bShown(false),
+	m_bShownApplied(false)
 {
 	m_hID = hCtrl;
 	m_pManager = pMgr;
-	m_pHorzAlign = hAlignHorz.copy();
-	m_pVertAlign = hAlignVert.copy();
-	m_bVisibilityBeforeTempHide = (::GetWindowLong(hCtrl, GWL_STYLE) & WS_VISIBLE) != FALSE;
-	updateOrigRect();
-	getRect();
-	m_pWndProc = (WNDPROC) ::GetWindowLong(hCtrl, GWL_WNDPROC);
-	s_mapControlForHwnd[hCtrl] = this;
+	assignSlot(m_aHorzAlign, hAlignHorz.getSlot(), true);
+	assignSlot(m_aVertAlign, hAlignVert.getSlot(), true);
+	initWindow();
+}
+
+/**
+ * CTor. Create a new Aligned Control instance with alignment slots.
+ * Built-in alignments are held by value, only custom modes are copied.
+ */
+Control::Control( Manager const* pMgr, HWND hCtrl, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName /*= ""*/ ) :
+	m_pAlignmentArea(NULL),
+	m_pManager(NULL),
+	m_bVisibilityBeforeTempHide(FALSE),
+	m_sName(sName),
+	m_bVirtual(false),
+	m_bVirtualHidden(false),
+	m_nKey(0),
+	m_bLayoutPending(false),
+	m_bShown(false),
+	m_bShownApplied(false)
+{
+	m_hID = hCtrl;
+	m_pManager = pMgr;
+	assignSlot(m_aHorzAlign, aAlignHorz, true);
+	assignSlot(m_aVertAlign, aAlignVert, true);
+	initWindow();
+}
+
+/**
+ * CTor. Create a new Aligned Control instance for a window whose rect was read by the caller,
+ * so that the rects of many controls can be mapped to client coords at once.
+ */
+Control::Control( Manager const* pMgr, HWND hCtrl, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName, CRect const& rctWindow ) :
+	m_pAlignmentArea(NULL),
+	m_pManager(NULL),
+	m_bVisibilityBeforeTempHide(FALSE),
+	m_sName(sName),
+	m_bVirtual(false),
+	m_bVirtualHidden(false),
+	m_nKey(0),
+	m_bLayoutPending(false),
+	m_bShown(false),
+	m_bShownApplied(false)
+{
+	m_hID = hCtrl;
+	m_pManager = pMgr;
+	assignSlot(m_aHorzAlign, aAlignHorz, true);
+	assignSlot(m_aVertAlign, aAlignVert, true);
+	initWindow(&rctWindow);
+}
+
+/**
+ * CTor. Create a virtual control. Its original and current rect are given in
+ * client coords of the managed window and maintained as pure geometry.
+ */
+Control::Control( Manager const* pMgr, UINT_PTR nKey, CRect const& rctOrig, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName /*= ""*/ ) :
+	m_hID(NULL),
+	m_rctOrig(rctOrig),
+	m_rctCurrent(rctOrig),
+	m_rctApplied(rctOrig),
+	m_pManager(pMgr),
+	m_pAlignmentArea(NULL),
+	m_bVisibilityBeforeTempHide(TRUE),
+	m_sName(sName),
+	m_pWndProc(NULL),
+	m_bVirtual(true),
+	m_bVirtualHidden(false),
+	m_nKey(nKey),
+	m_bLayoutPending(false),
+	m_bShown(true),
+	m_bShownApplied(true)
+{
+	assignSlot(m_aHorzAlign, aAlignHorz, true);
+	assignSlot(m_aVertAlign, aAlignVert, true);
+}
+
+/**
+ * Reads the initial state of the represented window.
+ */
+void Control::initWindow( CRect const* prctWindow /*= NULL*/ )
+{
+	m_bShown = m_bShownApplied = (::GetWindowLong(m_hID, GWL_STYLE) & WS_VISIBLE) != FALSE;
+	m_bVisibilityBeforeTempHide = m_bShown;
+	if(prctWindow)
+		m_rctOrig = m_rctCurrent = m_rctApplied = *prctWindow;
+	else
+	{
+		updateOrigRect();
+		getRect();
+	}
+	m_pWndProc = (WNDPROC) ::GetWindowLong(m_hID, GWL_WNDPROC);
+	s_mapControlForHwnd[m_hID] = this;
 	//installEditorWndProc(false);
 }
 
@@ -34,8 +126,8 @@ Control::Control( Manager const* pMgr, HWND hCtrl, Align::Mode& hAlignHorz, Alig
  */
 Control::~Control()
 {
-	delete m_pHorzAlign;
-	delete m_pVertAlign;
+	delete m_aHorzAlign.pMode;
+	delete m_aVertAlign.pMode;
 }
 
 /**
@@ -44,11 +136,18 @@ Control::~Control()
  */
 CRect const& Control::getRect() const
 {
+	// The geometry of virtual controls is maintained by the layout alone,
+	// the window of a pending control is not at its aligned rect yet
+	if (m_bVirtual || m_bLayoutPending)
+		return m_rctCurrent;
+
 	AFXASSUME(("Invalid handle!", m_hID && m_pManager));
 	if (m_hID && m_pManager)
 	{
 		getControl()->GetWindowRect(m_rctCurrent);
 		m_pManager->getWnd()->ScreenToClient(m_rctCurrent);
+		m_rctCurrent.OffsetRect(m_pManager->getViewportOrigin());
+		m_rctApplied = m_rctCurrent;
 		return m_rctCurrent;
 	}
 	
@@ -60,22 +159,85 @@ CRect const& Control::getRect() const
  */
 HDWP Control::update(HDWP windowPosHandle)
 {
-	CRect rctOld(getRect());
+	align();
+	return apply(windowPosHandle);
+}
+
+/**
+ * Align the current rect according to the specified modes. The window is left untouched.
+ */
+void Control::align()
+{
+	LAYOUT_TIME_PHASE(m_pManager->m_pPhaseClock, PhaseAlign);
+	getRect();
 	
 	// update horizontal and vertical alignment
-	m_pHorzAlign->update(this, Align::Horizontal, m_rctCurrent);
-	m_pVertAlign->update(this, Align::Vertical, m_rctCurrent); 
+	m_aHorzAlign.update(this, Align::Horizontal, m_rctCurrent);
+	m_aVertAlign.update(this, Align::Vertical, m_rctCurrent); 
+
+	m_pManager->m_pHitTestIndex->update(HitTestIndex::Element(HitTestIndex::KindControl, this), m_rctCurrent);
+	++m_pManager->m_aPassCounters.nEvaluated;
+}
+
+/**
+ * Move the window to the current rect. The current rect is in layout coords,
+ * the window is placed relative to the viewport origin of the manager.
+ */
+HDWP Control::apply(HDWP windowPosHandle)
+{
+	LAYOUT_TIME_PHASE(m_pManager->m_pPhaseClock, PhaseApply);
+	m_bLayoutPending = false;
+
+	// a virtual control without window is pure geometry
+	if (!m_hID)
+		return windowPosHandle;
 	
-	// enforce the new rect if necessary
+	Manager::PassCounters& aCounters = m_pManager->m_aPassCounters;
+	bool bMove = m_rctCurrent.TopLeft() != m_rctApplied.TopLeft();
+	bool bSize = m_rctCurrent.Size() != m_rctApplied.Size();
+
+	// most controls keep their rect when the window grows, e.g. all TopLeft ones
+	if (!bMove && !bSize)
+	{
+		if (m_bShown != m_bShownApplied)
+			return applyVisibility(windowPosHandle);
+
+		++aCounters.nSkipped;
+		return windowPosHandle;
+	}
+
+	UINT nFlags = SWP_NOZORDER|SWP_NOACTIVATE|SWP_NOOWNERZORDER;
+	if (m_bShown != m_bShownApplied)
+	{
+		// a folded area hides its controls in the same batch that moves them
+		++aCounters.nToggled;
+		nFlags |= m_bShown ? SWP_SHOWWINDOW : SWP_HIDEWINDOW;
+		m_bShownApplied = m_bShown;
+	}
+	if (bMove)
+		++aCounters.nMoved;
+	else
+		nFlags |= SWP_NOMOVE;
+	if (bSize)
+		++aCounters.nResized;
+	else
+		nFlags |= SWP_NOSIZE;
+
+	m_rctApplied = m_rctCurrent;
+
+	CRect rctClient(m_rctCurrent);
+	rctClient.OffsetRect(-m_pManager->getViewportOrigin());
+
+	// enforce the new rect
 	return DeferWindowPos(
 		windowPosHandle, 
 		getControl()->GetSafeHwnd(), 
 		HWND_TOP, 
-		m_rctCurrent.TopLeft().x, 
-		m_rctCurrent.TopLeft().y, 
-		m_rctCurrent.Width(), 
-		m_rctCurrent.Height(), 
-		SWP_NOZORDER|SWP_NOACTIVATE|SWP_NOOWNERZORDER
+		rctClient.TopLeft().x, 
+		rctClient.TopLeft().y, 
+		rctClient.Width(), 
+		rctClient.Height(), 
+		nFlags
 	);
 }
 
@@ -84,14 +246,30 @@ HDWP Control::update(HDWP windowPosHandle)
  */
 void Control::updateOrigRect()
 {
+	if (m_bVirtual || m_bLayoutPending)
+	{
+		m_rctOrig = m_rctCurrent;
+		return;
+	}
+
 	AFXASSUME(("Invalid handle!", m_hID && m_pManager));
 	if (m_hID && m_pManager)
 	{
 		getControl()->GetWindowRect(m_rctOrig);
 		m_pManager->getWnd()->ScreenToClient(m_rctOrig);
+		m_rctOrig.OffsetRect(m_pManager->getViewportOrigin());
 	}
 }
 
+/**
+ * Same as updateOrigRect(), but from the bookkeeping of apply(). The window is at m_rctApplied
+ * unless something else moved it, so this is what updateOrigRect() would read.
+ */
+void Control::rebaseOrigRect()
+{
+	m_rctOrig = (m_bVirtual || m_bLayoutPending) ? m_rctCurrent : m_rctApplied;
+}
+
 void Control::setAlignmentArea( Area const* pArea )
 {
 	m_pAlignmentArea = pArea;
@@ -109,44 +287,139 @@ const Area* Control::getArea() const
 
 void Control::getScreenRect(CRect& rctResult) const
 {
-	getControl()->GetWindowRect(rctResult);
+	if (m_bVirtual || m_bLayoutPending)
+	{
+		rctResult = m_rctCurrent;
+		rctResult.OffsetRect(-m_pManager->getViewportOrigin());
+		m_pManager->getWnd()->ClientToScreen(rctResult);
+	}
+	else
+		getControl()->GetWindowRect(rctResult);
 }
 
-void Control::getMinInsets(CRect& bounds) const
+bool Control::isShown() const
 {
-	if (::GetWindowLong(m_hID, GWL_STYLE) & WS_VISIBLE)
+	if (m_bVirtual)
+		return !m_bVirtualHidden;
+
+	return m_bShown;
+}
+
+void Control::getMinInsets(CRect& bounds, bool bFolded /*= false*/) const
+{
+	if (countsForMinSize(bFolded))
 	{
-		m_pHorzAlign->getMinInsets(this, Align::Horizontal, bounds);
-		m_pVertAlign->getMinInsets(this, Align::Vertical, bounds);
+		m_aHorzAlign.getMinInsets(this, Align::Horizontal, bounds);
+		m_aVertAlign.getMinInsets(this, Align::Vertical, bounds);
 	}
 }
 
-void Control::setHorzAlignment( Align::Mode* pAlignHorz )
+void Control::assignSlot( Align::Slot& aTarget, Align::Slot const& aSource, bool bCopyMode )
 {
-	if (m_pHorzAlign != pAlignHorz)
-		delete m_pHorzAlign;
+	Align::Mode* pMode = aSource.pMode;
+	if (bCopyMode && pMode)
+		pMode = pMode->copy();
+	
+	if (aTarget.pMode != pMode)
+		delete aTarget.pMode;
 	
-	m_pHorzAlign = pAlignHorz;
+	aTarget = aSource;
+	aTarget.pMode = pMode;
+}
+
+Align::Mode* Control::customizeSlot( Align::Slot& aSlot )
+{
+	if (aSlot.nKind != Align::KindCustom)
+	{
+		// The caller may change the mode at any time, so the built-in dispatch and whatever was derived from it are dropped
+		assignSlot(aSlot, Align::Slot(Align::KindCustom, 0, aSlot.createMode()), false);
+		alignmentChanged();
+	}
+	return aSlot.pMode;
+}
+
+Align::Mode* Control::getHorzAlignment()
+{
+	return customizeSlot(m_aHorzAlign);
+}
+
+Align::Mode* Control::getVertAlignment()
+{
+	return customizeSlot(m_aVertAlign);
+}
+
+void Control::setHorzAlignment( Align::Mode* pAlignHorz )
+{
+	Align::Slot aSlot(pAlignHorz->getSlot());
+	aSlot.pMode = pAlignHorz;
+	assignSlot(m_aHorzAlign, aSlot, false);
+	alignmentChanged();
 }
 
 void Control::setVertAlignment( Align::Mode* pAlignVert )
 {
-	if (m_pVertAlign != pAlignVert)
-		delete m_pVertAlign;
-	
-	m_pVertAlign = pAlignVert;
+	Align::Slot aSlot(pAlignVert->getSlot());
+	aSlot.pMode = pAlignVert;
+	assignSlot(m_aVertAlign, aSlot, false);
+	alignmentChanged();
+}
+
+void Control::setHorzAlignment( Align::Slot const& aAlignHorz )
+{
+	assignSlot(m_aHorzAlign, aAlignHorz, true);
+	alignmentChanged();
+}
+
+void Control::setVertAlignment( Align::Slot const& aAlignVert )
+{
+	assignSlot(m_aVertAlign, aAlignVert, true);
+	alignmentChanged();
+}
+
+void Control::alignmentChanged()
+{
+	if (m_pManager)
+		m_pManager->invalidateLayoutCache();
+	if (m_pAlignmentArea)
+		m_pAlignmentArea->invalidateMinSize();
 }
 
 void Control::temporaryHide()
 {
-	m_bVisibilityBeforeTempHide = (::GetWindowLong(m_hID, GWL_STYLE) & WS_VISIBLE) != FALSE;
-	::ShowWindow(m_hID, FALSE);
+	m_bVisibilityBeforeTempHide = isShown();
+	if (m_bVirtual)
+		m_bVirtualHidden = true;
+	else
+		m_bShown = false;
 }
 
 void Control::temporaryShow()
 {
 	if (m_bVisibilityBeforeTempHide)
-		::ShowWindow(m_hID, TRUE);
+	{
+		if (m_bVirtual)
+			m_bVirtualHidden = false;
+		else
+			m_bShown = true;
+	}
+}
+
+HDWP Control::applyVisibility(HDWP windowPosHandle)
+{
+	// the window of a virtual control is created or destroyed instead, see Manager::updateVirtualControl()
+	if (m_bVirtual || !m_hID || m_bShown == m_bShownApplied)
+		return windowPosHandle;
+
+	++m_pManager->m_aPassCounters.nToggled;
+	m_bShownApplied = m_bShown;
+
+	return DeferWindowPos(
+		windowPosHandle,
+		m_hID,
+		NULL,
+		0, 0, 0, 0,
+		SWP_NOMOVE|SWP_NOSIZE|SWP_NOZORDER|SWP_NOACTIVATE|SWP_NOOWNERZORDER|(m_bShown ? SWP_SHOWWINDOW : SWP_HIDEWINDOW)
+	);
 }
 
 std::map<HWND, Control*> Layout::Control::s_mapControlForHwnd;
@@ -0,0 +1,490 @@
+// This file does not use the precompiled header on purpose:
+// The description must stay free of any MFC/Win32 dependency.
+
+#include "../../GlobExport/description.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+
+using namespace Layout;
+
+namespace
+{
+const char IMAGE_MAGIC[4] = {'D', 'L', 'Y', 'T'};
+const boost::uint32_t IMAGE_VERSION = 1;
+// The tables are used in place, their entries consist of 32 and 16 bit fields
+const size_t IMAGE_ALIGNMENT = sizeof(boost::uint32_t);
+
+struct ImageHeader
+{
+	char achMagic[4];
+	boost::uint32_t nVersion;
+	boost::uint32_t nControls;
+	boost::uint32_t nSplitters;
+	boost::uint32_t nAreas;
+	boost::uint32_t nStringBytes;
+};
+
+/** Splits a line into whitespace separated tokens. Double quotes group a token,
+    '#' at a token boundary starts a comment. */
+bool Tokenize(std::string const& sLine, std::vector<std::string>& vTokens)
+{
+	vTokens.clear();
+	std::string sToken;
+	bool bInToken = false, bQuoted = false;
+
+	for (std::string::const_iterator it = sLine.begin(); it != sLine.end(); ++it)
+	{
+		char ch = *it;
+		if (bQuoted)
+		{
+			if (ch == '"')
+				bQuoted = false;
+			else
+				sToken += ch;
+		}
+		else if (ch == '"')
+		{
+			bQuoted = bInToken = true;
+		}
+		else if (ch == '#' && !bInToken)
+		{
+			// Comments start at a token boundary, colors like "#RRGGBB" are part of a token
+			break;
+		}
+		else if (ch == ' ' || ch == '\t' || ch == '\r')
+		{
+			if (bInToken)
+				vTokens.push_back(sToken);
+			sToken.clear();
+			bInToken = false;
+		}
+		else
+		{
+			sToken += ch;
+			bInToken = true;
+		}
+	}
+
+	if (bInToken)
+		vTokens.push_back(sToken);
+
+	return !bQuoted;
+}
+
+bool ParseUnsigned(std::string const& sValue, boost::uint32_t& nResult)
+{
+	if (sValue.empty())
+		return false;
+
+	char* pchEnd = NULL;
+	unsigned long nValue = strtoul(sValue.c_str(), &pchEnd, 0);
+	if (*pchEnd != '\0')
+		return false;
+
+	nResult = (boost::uint32_t) nValue;
+	return true;
+}
+
+/** Parses alignment tokens like "topleft" or "resize:30". */
+bool ParseAlignment(std::string const& sValue, boost::uint16_t& nKind, boost::uint16_t& nMinSize)
+{
+	std::string sKind = sValue;
+	nMinSize = 0;
+
+	std::string::size_type nColon = sValue.find(':');
+	if (nColon != std::string::npos)
+	{
+		boost::uint32_t nValue = 0;
+		if (!ParseUnsigned(sValue.substr(nColon + 1), nValue) || nValue > 0xFFFF)
+			return false;
+		nMinSize = (boost::uint16_t) nValue;
+		sKind = sValue.substr(0, nColon);
+	}
+
+	if (sKind == "topleft")
+		nKind = Description::AlignTopLeft;
+	else if (sKind == "resize")
+		nKind = Description::AlignResize;
+	else if (sKind == "fit")
+		nKind = Description::AlignFit;
+	else if (sKind == "bottomright")
+		nKind = Description::AlignBottomRight;
+	else if (sKind == "relative")
+		nKind = Description::AlignRelative;
+	else if (sKind == "relative-resize")
+		nKind = Description::AlignRelativeResize;
+	else
+		return false;
+
+	// Only resizing alignments know a minimum size
+	return nMinSize == 0 || nKind == Description::AlignResize;
+}
+
+/** Parses "#RRGGBB" into COLORREF layout (0x00BBGGRR). */
+bool ParseColor(std::string const& sValue, boost::uint32_t& crResult)
+{
+	if (sValue.size() != 7 || sValue[0] != '#')
+		return false;
+
+	boost::uint32_t nRgb = 0;
+	if (!ParseUnsigned("0x" + sValue.substr(1), nRgb))
+		return false;
+
+	crResult = ((nRgb >> 16) & 0xFF) | (nRgb & 0xFF00) | ((nRgb & 0xFF) << 16);
+	return true;
+}
+
+/** Intermediate tables, filled by the parser and packed into the image. */
+struct Tables
+{
+	Tables()
+	{
+		// Offset 0 is the empty string
+		vStrings.push_back('\0');
+	}
+
+	boost::uint32_t addString(std::string const& sValue)
+	{
+		if (sValue.empty())
+			return 0;
+
+		boost::uint32_t nOffset = (boost::uint32_t) vStrings.size();
+		vStrings.insert(vStrings.end(), sValue.begin(), sValue.end());
+		vStrings.push_back('\0');
+		return nOffset;
+	}
+
+	bool findControl(std::string const& sName, boost::uint32_t& nIndex) const
+	{
+		for (nIndex = 0; nIndex < vControls.size(); ++nIndex)
+			if (sName == &vStrings[vControls[nIndex].nName])
+				return true;
+		return false;
+	}
+
+	std::vector<Description::ControlEntry> vControls;
+	std::vector<Description::SplitterEntry> vSplitters;
+	std::vector<Description::AreaEntry> vAreas;
+	std::vector<char> vStrings;
+};
+
+template<class T>
+void AppendTable(std::vector<char>& vImage, std::vector<T> const& vTable)
+{
+	if (!vTable.empty())
+	{
+		char const* pchBegin = reinterpret_cast<char const*>(&vTable[0]);
+		vImage.insert(vImage.end(), pchBegin, pchBegin + vTable.size() * sizeof(T));
+	}
+}
+
+void Pack(Tables const& aTables, std::vector<char>& vImage)
+{
+	ImageHeader aHeader;
+	memcpy(aHeader.achMagic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	aHeader.nVersion = IMAGE_VERSION;
+	aHeader.nControls = (boost::uint32_t) aTables.vControls.size();
+	aHeader.nSplitters = (boost::uint32_t) aTables.vSplitters.size();
+	aHeader.nAreas = (boost::uint32_t) aTables.vAreas.size();
+	aHeader.nStringBytes = (boost::uint32_t) aTables.vStrings.size();
+
+	vImage.clear();
+	vImage.reserve(sizeof(aHeader)
+		+ aTables.vControls.size() * sizeof(Description::ControlEntry)
+		+ aTables.vSplitters.size() * sizeof(Description::SplitterEntry)
+		+ aTables.vAreas.size() * sizeof(Description::AreaEntry)
+		+ aTables.vStrings.size());
+
+	char const* pchHeader = reinterpret_cast<char const*>(&aHeader);
+	vImage.insert(vImage.end(), pchHeader, pchHeader + sizeof(aHeader));
+	AppendTable(vImage, aTables.vControls);
+	AppendTable(vImage, aTables.vSplitters);
+	AppendTable(vImage, aTables.vAreas);
+	AppendTable(vImage, aTables.vStrings);
+}
+}
+
+Description::Description() :
+	m_nControls(0),
+	m_nSplitters(0),
+	m_nAreas(0),
+	m_pControls(NULL),
+	m_pSplitters(NULL),
+	m_pAreas(NULL),
+	m_pStrings(NULL),
+	m_nStringBytes(0)
+{
+	clear();
+}
+
+Description::Description( Description const& aOther ) :
+	m_nControls(0),
+	m_nSplitters(0),
+	m_nAreas(0),
+	m_pControls(NULL),
+	m_pSplitters(NULL),
+	m_pAreas(NULL),
+	m_pStrings(NULL),
+	m_nStringBytes(0)
+{
+	*this = aOther;
+}
+
+Description& Description::operator=( Description const& aOther )
+{
+	if (this != &aOther)
+	{
+		std::vector<char> vImage;
+		aOther.toBinary(vImage);
+		m_vImage.swap(vImage);
+		attach(&m_vImage[0], m_vImage.size());
+	}
+	return *this;
+}
+
+void Description::clear()
+{
+	Tables aEmpty;
+	Pack(aEmpty, m_vImage);
+	attach(&m_vImage[0], m_vImage.size());
+}
+
+bool Description::parse( char const* pchText, std::string* psError )
+{
+	Tables aTables;
+	std::istringstream aInput(pchText ? pchText : "");
+	std::string sLine, sReason;
+	std::vector<std::string> vTokens;
+	int iLine = 0;
+
+	while (sReason.empty() && std::getline(aInput, sLine))
+	{
+		++iLine;
+		if (!Tokenize(sLine, vTokens))
+		{
+			sReason = "unterminated string";
+			break;
+		}
+
+		if (vTokens.empty())
+			continue;
+
+		std::string const& sStatement = vTokens[0];
+		if (sStatement == "control")
+		{
+			Description::ControlEntry aEntry;
+			boost::uint32_t nExisting = 0;
+
+			if (vTokens.size() != 5)
+				sReason = "expected: control <name> <id> <horz> <vert>";
+			else if (aTables.findControl(vTokens[1], nExisting))
+				sReason = "duplicate control '" + vTokens[1] + "'";
+			else if (!ParseUnsigned(vTokens[2], aEntry.nId))
+				sReason = "invalid control id '" + vTokens[2] + "'";
+			else if (!ParseAlignment(vTokens[3], aEntry.nHorz, aEntry.nHorzMin))
+				sReason = "invalid alignment '" + vTokens[3] + "'";
+			else if (!ParseAlignment(vTokens[4], aEntry.nVert, aEntry.nVertMin))
+				sReason = "invalid alignment '" + vTokens[4] + "'";
+			else
+			{
+				aEntry.nName = aTables.addString(vTokens[1]);
+				aTables.vControls.push_back(aEntry);
+			}
+		}
+		else if (sStatement == "splitter")
+		{
+			Description::SplitterEntry aEntry;
+
+			if (vTokens.size() != 5)
+				sReason = "expected: splitter <high> <low> horizontal|vertical high|low|relative";
+			else if (!aTables.findControl(vTokens[1], aEntry.nHigh))
+				sReason = "unknown control '" + vTokens[1] + "'";
+			else if (!aTables.findControl(vTokens[2], aEntry.nLow))
+				sReason = "unknown control '" + vTokens[2] + "'";
+			else
+			{
+				if (vTokens[3] == "horizontal")
+					aEntry.nOrientation = SplitHorizontal;
+				else if (vTokens[3] == "vertical")
+					aEntry.nOrientation = SplitVertical;
+				else
+					sReason = "invalid orientation '" + vTokens[3] + "'";
+
+				if (vTokens[4] == "high")
+					aEntry.nAlignment = SplitAlignHigh;
+				else if (vTokens[4] == "low")
+					aEntry.nAlignment = SplitAlignLow;
+				else if (vTokens[4] == "relative")
+					aEntry.nAlignment = SplitAlignRelative;
+				else if (sReason.empty())
+					sReason = "invalid splitter alignment '" + vTokens[4] + "'";
+
+				if (sReason.empty())
+					aTables.vSplitters.push_back(aEntry);
+			}
+		}
+		else if (sStatement == "area")
+		{
+			Description::AreaEntry aEntry;
+			memset(&aEntry, 0, sizeof(aEntry));
+
+			if (vTokens.size() < 2)
+				sReason = "expected: area <control> [properties]";
+			else if (!aTables.findControl(vTokens[1], aEntry.nControl))
+				sReason = "unknown control '" + vTokens[1] + "'";
+
+			for (size_t i = 2; sReason.empty() && i < vTokens.size(); ++i)
+			{
+				std::string const& sToken = vTokens[i];
+				std::string::size_type nEquals = sToken.find('=');
+				std::string sKey = sToken.substr(0, nEquals);
+				std::string sValue = nEquals == std::string::npos ? "" : sToken.substr(nEquals + 1);
+
+				if (sKey == "foldable" && nEquals == std::string::npos)
+					aEntry.nStyle |= StyleFoldable;
+				else if (sKey == "leftline" && nEquals == std::string::npos)
+					aEntry.nStyle |= StyleDrawLeftLine;
+				else if (sKey == "title" && nEquals != std::string::npos)
+				{
+					aEntry.nStyle |= StyleDrawTitle;
+					aEntry.nTitle = aTables.addString(sValue);
+				}
+				else if (sKey == "background" && ParseColor(sValue, aEntry.crBk))
+					aEntry.nStyle |= StyleDrawBk;
+				else if (sKey == "hover" && ParseColor(sValue, aEntry.crHover))
+					aEntry.nStyle |= StyleHover;
+				else if (sKey == "text" && ParseColor(sValue, aEntry.crText))
+					;
+				else if (sKey == "hovertext" && ParseColor(sValue, aEntry.crHoverText))
+					aEntry.nStyle |= StyleHoverTitle;
+				else
+					sReason = "invalid area property '" + sToken + "'";
+			}
+
+			if (sReason.empty())
+				aTables.vAreas.push_back(aEntry);
+		}
+		else
+			sReason = "unknown statement '" + sStatement + "'";
+	}
+
+	if (!sReason.empty())
+	{
+		if (psError)
+		{
+			std::ostringstream aError;
+			aError << "line " << iLine << ": " << sReason;
+			*psError = aError.str();
+		}
+		clear();
+		return false;
+	}
+
+	Pack(aTables, m_vImage);
+	return attach(&m_vImage[0], m_vImage.size());
+}
+
+bool Description::loadBinary( void const* pData, size_t nSize, bool bCopy )
+{
+	char const* pchData = static_cast<char const*>(pData);
+
+	// An image read at any offset of a file, e.g. a trace, may not be aligned for the tables
+	if (bCopy || reinterpret_cast<size_t>(pData) % IMAGE_ALIGNMENT != 0)
+	{
+		std::vector<char> vImage(pchData, pchData + nSize);
+		m_vImage.swap(vImage);
+		pchData = m_vImage.empty() ? NULL : &m_vImage[0];
+	}
+	else
+		m_vImage.clear();
+
+	if (!attach(pchData, nSize))
+	{
+		clear();
+		return false;
+	}
+	return true;
+}
+
+void Description::toBinary( std::vector<char>& vResult ) const
+{
+	char const* pchBegin = reinterpret_cast<char const*>(m_pControls) - sizeof(ImageHeader);
+	vResult.assign(pchBegin, m_pStrings + m_nStringBytes);
+}
+
+size_t Description::findControl( char const* pchName ) const
+{
+	for (size_t i = 0; i < m_nControls; ++i)
+		if (strcmp(getString(m_pControls[i].nName), pchName) == 0)
+			return i;
+	return m_nControls;
+}
+
+bool Description::attach( char const* pData, size_t nSize )
+{
+	if (pData == NULL || nSize < sizeof(ImageHeader))
+		return false;
+
+	ImageHeader aHeader;
+	memcpy(&aHeader, pData, sizeof(aHeader));
+	if (memcmp(aHeader.achMagic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || aHeader.nVersion != IMAGE_VERSION)
+		return false;
+
+	// Guards the size calculation below against overflowing counts
+	if (aHeader.nControls > nSize / sizeof(ControlEntry) || aHeader.nSplitters > nSize / sizeof(SplitterEntry)
+		|| aHeader.nAreas > nSize / sizeof(AreaEntry) || aHeader.nStringBytes > nSize)
+		return false;
+
+	size_t nControlBytes = aHeader.nControls * sizeof(ControlEntry);
+	size_t nSplitterBytes = aHeader.nSplitters * sizeof(SplitterEntry);
+	size_t nAreaBytes = aHeader.nAreas * sizeof(AreaEntry);
+
+	// Each table must fit into what is left of the buffer, so the partial sums cannot wrap either
+	size_t nRemaining = nSize - sizeof(aHeader);
+	if (nControlBytes > nRemaining)
+		return false;
+	nRemaining -= nControlBytes;
+	if (nSplitterBytes > nRemaining)
+		return false;
+	nRemaining -= nSplitterBytes;
+	if (nAreaBytes > nRemaining)
+		return false;
+	nRemaining -= nAreaBytes;
+	if (aHeader.nStringBytes > nRemaining)
+		return false;
+
+	size_t nExpected = sizeof(aHeader) + nControlBytes + nSplitterBytes + nAreaBytes + aHeader.nStringBytes;
+	if (aHeader.nStringBytes == 0 || pData[nExpected - 1] != '\0')
+		return false;
+
+	char const* pchCursor = pData + sizeof(aHeader);
+	ControlEntry const* pControls = reinterpret_cast<ControlEntry const*>(pchCursor);
+	pchCursor += nControlBytes;
+	SplitterEntry const* pSplitters = reinterpret_cast<SplitterEntry const*>(pchCursor);
+	pchCursor += nSplitterBytes;
+	AreaEntry const* pAreas = reinterpret_cast<AreaEntry const*>(pchCursor);
+	pchCursor += nAreaBytes;
+
+	// Verify the references, so the tables can be used without further checks
+	for (size_t i = 0; i < aHeader.nControls; ++i)
+		if (pControls[i].nName >= aHeader.nStringBytes)
+			return false;
+	for (size_t i = 0; i < aHeader.nSplitters; ++i)
+		if (pSplitters[i].nHigh >= aHeader.nControls || pSplitters[i].nLow >= aHeader.nControls)
+			return false;
+	for (size_t i = 0; i < aHeader.nAreas; ++i)
+		if (pAreas[i].nControl >= aHeader.nControls || pAreas[i].nTitle >= aHeader.nStringBytes)
+			return false;
+
+	m_nControls = aHeader.nControls;
+	m_nSplitters = aHeader.nSplitters;
+	m_nAreas = aHeader.nAreas;
+	m_pControls = pControls;
+	m_pSplitters = pSplitters;
+	m_pAreas = pAreas;
+	m_pStrings = pchCursor;
+	m_nStringBytes = aHeader.nStringBytes;
+	return true;
+}
@@ -21,7 +21,10 @@ ManagedDialog::ManagedDialog( UINT nID, CWnd* pParent ) : CDialog(nID, pParent),
 	m_hMaxSize = CSize(0, 0);
 	m_sResource = "";
 	m_nID = nID;
+	m_nMinSizeBehaviour = BlockSmallerSizes;
 	m_ptScrollPos.x = m_ptScrollPos.y = 0;
+	m_iCliRctDX = m_iCliRctDY = -1;
+	m_hScrollRange = m_hScrollPage = CSize(-1, -1);
 	m_hMinSize.cx = m_hMinSize.cy = 0;
 }
 
@@ -64,6 +67,8 @@ ManagedDialog::ManagedDialog(
 	m_nID = nID;
 	m_nMinSizeBehaviour = BlockSmallerSizes;
 	m_ptScrollPos.x = m_ptScrollPos.y = 0;
+	m_iCliRctDX = m_iCliRctDY = -1;
+	m_hScrollRange = m_hScrollPage = CSize(-1, -1);
 }
 
 ManagedDialog::ManagedDialog(
@@ -82,6 +87,8 @@ ManagedDialog::ManagedDialog(
 	m_nID = nID;
 	m_nMinSizeBehaviour = nMinSizeBehaviour;
 	m_ptScrollPos.x = m_ptScrollPos.y = 0;
+	m_iCliRctDX = m_iCliRctDY = -1;
+	m_hScrollRange = m_hScrollPage = CSize(-1, -1);
 }
 
 /**
@@ -124,6 +131,14 @@ BOOL ManagedDialog::OnInitDialog()
 	// call the super dialog initialization
 	CDialog::OnInitDialog();
 	
+	// A scrollable dialog only moves the controls in view, the others follow when they are scrolled to.
+	// The system must not stop the sizing at the min size in the dimensions which scroll.
+	if( m_nMinSizeBehaviour != BlockSmallerSizes && getManager() )
+	{
+		getManager()->setViewportMode(true);
+		getManager()->setMinTrackSize(!(m_nMinSizeBehaviour & ShowScrollbarsX), !(m_nMinSizeBehaviour & ShowScrollbarsY));
+	}
+	
 	return true;
 }
 
@@ -137,7 +152,7 @@ void ManagedDialog::OnSizing(UINT nSide, LPRECT lpRect)
 	if( m_nMinSizeBehaviour > 0 )
 	{
 		RECT hRect = *lpRect;
-		getAlignmentManager()->update(nSide, lpRect);
+		getManager()->clampRect(nSide, lpRect);
 		
 		/* If the MinSizeBehaviour is ShowScrollbars, then
 		 * the alignment managers output regarding lpRect
@@ -171,8 +186,8 @@ void ManagedDialog::OnSizing(UINT nSide, LPRECT lpRect)
 				OnVScroll( SB_SHIFT, -(iDY > iScrollPos ? iScrollPos : iDY), NULL );
 		}
 	}
-	else
-		getAlignmentManager()->update(nSide, lpRect);
+	// The system has clamped lpRect to the track sizes the manager publishes on WM_GETMINMAXINFO already,
+	// except for the dimensions which scroll, see OnInitDialog()
 }
 
 /**
@@ -199,35 +214,62 @@ void ManagedDialog::updateScrollbars(int iWidth, int iHeight)
 {
 	if((m_nMinSizeBehaviour & ShowScrollbarsX) || (m_nMinSizeBehaviour & ShowScrollbarsY))
 	{
-		// calculate client rect difference
-		RECT rctCur;
-		RECT rctCli;
-		this->GetWindowRect(&rctCur);
-		this->GetClientRect(&rctCli);
-		int iCliRctDX = (rctCur.right - rctCur.left) - (rctCli.right - rctCli.left);
-		int iCliRctDY = (rctCur.bottom - rctCur.top) - (rctCli.bottom - rctCli.top);
-	
+		// calculate client rect difference once, before any scrollbar takes space from the client rect
+		if( m_iCliRctDX < 0 )
+		{
+			RECT rctCur;
+			RECT rctCli;
+			this->GetWindowRect(&rctCur);
+			this->GetClientRect(&rctCli);
+			m_iCliRctDX = (rctCur.right - rctCur.left) - (rctCli.right - rctCli.left);
+			m_iCliRctDY = (rctCur.bottom - rctCur.top) - (rctCli.bottom - rctCli.top);
+		}
+		
+		CSize hRange(m_hMinSize.cx - m_iCliRctDX, m_hMinSize.cy - m_iCliRctDY);
+		CSize hPage(iWidth + 1, iHeight + 1);
+		
+		// SetScrollInfo redraws the scrollbars, so it is only called for actual changes
+		SCROLLINFO hScrollInfo;
+		hScrollInfo.cbSize = sizeof(SCROLLINFO);
+		hScrollInfo.fMask = SIF_PAGE|SIF_RANGE;
+		hScrollInfo.nMin = 0;
+		
 		// Horizontal
-		SCROLLINFO hScrollInfoH;
-		hScrollInfoH.cbSize = sizeof(SCROLLINFO);
-		hScrollInfoH.fMask = SIF_PAGE|SIF_RANGE;
-		hScrollInfoH.nMin = 0;
-		hScrollInfoH.nMax = m_hMinSize.cx - iCliRctDX;
-		hScrollInfoH.nPage = iWidth + 1;
+		if( hRange.cx != m_hScrollRange.cx || hPage.cx != m_hScrollPage.cx )
+		{
+			hScrollInfo.nMax = hRange.cx;
+			hScrollInfo.nPage = hPage.cx;
+			SetScrollInfo(SB_HORZ, &hScrollInfo, TRUE);
+		}
 		
 		// Vertical
-		SCROLLINFO hScrollInfoV;
-		hScrollInfoV.cbSize = sizeof(SCROLLINFO);
-		hScrollInfoV.fMask = SIF_PAGE|SIF_RANGE;
-		hScrollInfoV.nMin = 0;
-		hScrollInfoV.nMax = m_hMinSize.cy - iCliRctDY;
-		hScrollInfoV.nPage = iHeight + 1;
+		if( hRange.cy != m_hScrollRange.cy || hPage.cy != m_hScrollPage.cy )
+		{
+			hScrollInfo.nMax = hRange.cy;
+			hScrollInfo.nPage = hPage.cy;
+			SetScrollInfo(SB_VERT, &hScrollInfo, TRUE);
+		}
 		
-		SetScrollInfo(SB_HORZ, &hScrollInfoH, TRUE); 
-		SetScrollInfo(SB_VERT, &hScrollInfoV, TRUE);
+		m_hScrollRange = hRange;
+		m_hScrollPage = hPage;
 	}
 }
 
+/**
+ * Helper function called in OnHScroll and OnVScroll
+ */
+void ManagedDialog::scrollTo(POINT ptPos)
+{
+	POINT ptOld = m_ptScrollPos;
+	m_ptScrollPos = ptPos;
+	
+	// The manager moves all children at once and positions the controls it deferred
+	if( getManager() )
+		getManager()->scrollViewport(ptPos);
+	else
+		ScrollWindow(ptOld.x - ptPos.x, ptOld.y - ptPos.y);
+}
+
 /**
  * ManagedDialog::OnMove
  */
@@ -252,8 +294,8 @@ void ManagedDialog::OnSize(UINT nType, int cx, int cy)
 	
 	/* React on maximization */
 	if(nType == SIZE_MAXIMIZED || nType == SIZE_RESTORED)
-		if ( this->getAlignmentManager() )
-			this->getAlignmentManager()->update();
+		if ( this->getManager() )
+			this->getManager()->update();
 }
 
 /**
@@ -307,9 +349,12 @@ void ManagedDialog::OnHScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar)
 		}
 	} // switch
 	
-	m_ptScrollPos.x = iNew;
-  SetScrollPos(SB_HORZ, iNew, TRUE);
-  ScrollWindow(iCur - iNew, 0);
+	if( iNew == iCur )
+		return;
+	
+	CPoint ptPos(iNew, m_ptScrollPos.y);
+	SetScrollPos(SB_HORZ, iNew, TRUE);
+	scrollTo(ptPos);
 }
 
 /**
@@ -364,7 +409,10 @@ void ManagedDialog::OnVScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar)
 		}
 	} // switch
 	
-	m_ptScrollPos.y = iNew;
-  SetScrollPos(SB_VERT, iNew, TRUE);
-  ScrollWindow(0, iCur - iNew);
+	if( iNew == iCur )
+		return;
+	
+	CPoint ptPos(m_ptScrollPos.x, iNew);
+	SetScrollPos(SB_VERT, iNew, TRUE);
+	scrollTo(ptPos);
 }
@@ -0,0 +1,90 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/hittestindex.h"
+#include "../../GlobExport/splitter.h"
+#include "../../GlobExport/spatialindex.h"
+
+using namespace Layout;
+
+Splitter* HitTestIndex::Element::getSplitter() const
+{
+	return nKind == KindSplitter ? static_cast<Splitter*>(pControl) : NULL;
+}
+
+HitTestIndex::HitTestIndex() :
+	m_pIndex(new SpatialIndex<Element>())
+{
+}
+
+HitTestIndex::~HitTestIndex()
+{
+	delete m_pIndex;
+}
+
+bool HitTestIndex::Element::operator<( Element const& rhs ) const
+{
+	if(nKind != rhs.nKind)
+		return nKind < rhs.nKind;
+	if(pArea != rhs.pArea)
+		return pArea < rhs.pArea;
+	return pControl < rhs.pControl;
+}
+
+void HitTestIndex::update( Element const& aElement, CRect const& rctLayout )
+{
+	std::map<Element, CRect>::iterator it = m_mapRects.find(aElement);
+	if(it != m_mapRects.end())
+	{
+		if(it->second == rctLayout)
+			return;
+
+		m_pIndex->remove(it->second, aElement);
+		m_mapRects.erase(it);
+	}
+
+	// Folded or collapsed elements may be empty or even inverted, they cannot be hit
+	if(rctLayout.Width() <= 0 || rctLayout.Height() <= 0)
+		return;
+
+	m_pIndex->insert(rctLayout, aElement);
+	m_mapRects.insert(std::make_pair(aElement, rctLayout));
+}
+
+void HitTestIndex::remove( Element const& aElement )
+{
+	std::map<Element, CRect>::iterator it = m_mapRects.find(aElement);
+	if(it == m_mapRects.end())
+		return;
+
+	m_pIndex->remove(it->second, aElement);
+	m_mapRects.erase(it);
+}
+
+void HitTestIndex::queryPoint( POINT ptLayout, std::vector<Element>& vResult ) const
+{
+	std::vector<Element> vCandidates;
+	m_pIndex->queryPoint(ptLayout, vCandidates);
+
+	// The index treats the rects as closed
+	for(std::vector<Element>::const_iterator it = vCandidates.begin(); it != vCandidates.end(); ++it)
+		if(m_mapRects.find(*it)->second.PtInRect(ptLayout))
+			vResult.push_back(*it);
+}
+
+void HitTestIndex::queryIntersecting( CRect const& rctLayout, std::vector<Element>& vResult ) const
+{
+	std::vector<Element> vCandidates;
+	m_pIndex->queryIntersecting(rctLayout, vCandidates);
+
+	// The index treats the rects as closed, touching rects do not intersect
+	CRect rctIntersection;
+	for(std::vector<Element>::const_iterator it = vCandidates.begin(); it != vCandidates.end(); ++it)
+		if(rctIntersection.IntersectRect(&m_mapRects.find(*it)->second, &rctLayout))
+			vResult.push_back(*it);
+}
+
+void HitTestIndex::queryContaining( CRect const& rctLayout, std::vector<Element>& vResult ) const
+{
+	m_pIndex->queryContaining(rctLayout, vResult);
+}
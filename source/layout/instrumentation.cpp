@@ -0,0 +1,301 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/instrumentation.h"
+
+#include <map>
+#include <sstream>
+
+using namespace Layout;
+
+namespace
+{
+/** Guards the identifier registry and the histograms, which may be shared by managers on different threads. */
+class StatsLock
+{
+public:
+	StatsLock() { ::EnterCriticalSection(&s_aSection); }
+	~StatsLock() { ::LeaveCriticalSection(&s_aSection); }
+
+	static void init() { ::InitializeCriticalSection(&s_aSection); }
+
+private:
+	static CRITICAL_SECTION s_aSection;
+};
+
+CRITICAL_SECTION StatsLock::s_aSection;
+
+typedef std::map<std::string, LayoutStats*> StatsMap;
+
+/** The registry is never destroyed, managers may still be alive while static objects are torn down. */
+StatsMap& GetStatsMap()
+{
+	static StatsMap* s_pMap = NULL;
+	if(!s_pMap)
+	{
+		StatsLock::init();
+		s_pMap = new StatsMap();
+	}
+	return *s_pMap;
+}
+
+/** Creates the registry and its lock while the library is loaded, before any second thread can ask for it. */
+struct StatsMapInit
+{
+	StatsMapInit() { GetStatsMap(); }
+} s_aStatsMapInit;
+
+double TicksToUs(boost::int64_t nTicks)
+{
+	static boost::int64_t s_nFrequency = 0;
+	if(!s_nFrequency)
+	{
+		LARGE_INTEGER nFrequency;
+		::QueryPerformanceFrequency(&nFrequency);
+		s_nFrequency = nFrequency.QuadPart;
+	}
+	return (double) nTicks * 1000000.0 / (double) s_nFrequency;
+}
+
+boost::int64_t Now()
+{
+	LARGE_INTEGER nNow;
+	::QueryPerformanceCounter(&nNow);
+	return nNow.QuadPart;
+}
+
+void HistogramToJson(LayoutStats::Histogram const& aHistogram, std::ostringstream& aStream)
+{
+	aStream << "{\"count\":" << aHistogram.nCount
+		<< ",\"p50_us\":" << aHistogram.percentile(0.5)
+		<< ",\"p99_us\":" << aHistogram.percentile(0.99)
+		<< ",\"max_us\":" << aHistogram.dMaxUs
+		<< ",\"total_us\":" << aHistogram.dTotalUs << "}";
+}
+
+void AppendJsonString(std::string const& sValue, std::ostringstream& aStream)
+{
+	aStream << '"';
+	for(std::string::const_iterator it = sValue.begin(); it != sValue.end(); ++it)
+	{
+		if(*it == '"' || *it == '\\')
+			aStream << '\\' << *it;
+		else if((unsigned char) *it < 0x20)
+			aStream << ' ';
+		else
+			aStream << *it;
+	}
+	aStream << '"';
+}
+}
+
+/***************************************************************
+                          Histogram
+ **************************************************************/
+
+LayoutStats::Histogram::Histogram() :
+	nCount(0),
+	dTotalUs(0),
+	dMaxUs(0)
+{
+	for(int nBucket = 0; nBucket < BucketCount; ++nBucket)
+		aBuckets[nBucket] = 0;
+}
+
+void LayoutStats::Histogram::add( double dUs )
+{
+	int nBucket = 0;
+	for(double dBound = 1.0; dUs >= dBound && nBucket < BucketCount - 1; dBound *= 2.0)
+		++nBucket;
+
+	++aBuckets[nBucket];
+	++nCount;
+	dTotalUs += dUs;
+	if(dUs > dMaxUs)
+		dMaxUs = dUs;
+}
+
+double LayoutStats::Histogram::percentile( double dFraction ) const
+{
+	if(nCount == 0)
+		return 0;
+
+	unsigned int nRank = (unsigned int) (dFraction * nCount);
+	if(nRank >= nCount)
+		nRank = nCount - 1;
+
+	unsigned int nSeen = 0;
+	double dBound = 1.0;
+	for(int nBucket = 0; nBucket < BucketCount; ++nBucket, dBound *= 2.0)
+	{
+		nSeen += aBuckets[nBucket];
+		if(nSeen > nRank)
+			return dBound < dMaxUs ? dBound : dMaxUs;
+	}
+	return dMaxUs;
+}
+
+/***************************************************************
+                          LayoutStats
+ **************************************************************/
+
+LayoutStats::LayoutStats( std::string const& sIdentifier ) :
+	m_sIdentifier(sIdentifier)
+{
+}
+
+void LayoutStats::addPass( double const* pdPhaseUs, bool const* pbPhaseEntered )
+{
+	StatsLock aLock;
+
+	double dPassUs = 0;
+	for(int nPhase = 0; nPhase < PhaseCount; ++nPhase)
+	{
+		if(!pbPhaseEntered[nPhase])
+			continue;
+		m_aPhases[nPhase].add(pdPhaseUs[nPhase]);
+		dPassUs += pdPhaseUs[nPhase];
+	}
+	m_aPass.add(dPassUs);
+}
+
+void LayoutStats::reset()
+{
+	StatsLock aLock;
+
+	for(int nPhase = 0; nPhase < PhaseCount; ++nPhase)
+		m_aPhases[nPhase] = Histogram();
+	m_aPass = Histogram();
+}
+
+char const* LayoutStats::getPhaseName( Phase nPhase )
+{
+	switch(nPhase)
+	{
+	case PhaseUpdate:     return "update";
+	case PhaseMinSize:    return "minsize";
+	case PhaseSplitter:   return "splitter";
+	case PhaseAlign:      return "align";
+	case PhaseApply:      return "apply";
+	case PhaseInvalidate: return "invalidate";
+	case PhaseDraw:       return "draw";
+	default:              return "unknown";
+	}
+}
+
+void LayoutStats::toJson( std::string& sResult ) const
+{
+	std::ostringstream aStream;
+	{
+		StatsLock aLock;
+
+		aStream << "{\"identifier\":";
+		AppendJsonString(m_sIdentifier, aStream);
+		aStream << ",\"pass\":";
+		HistogramToJson(m_aPass, aStream);
+		aStream << ",\"phases\":{";
+		for(int nPhase = 0; nPhase < PhaseCount; ++nPhase)
+		{
+			if(nPhase > 0)
+				aStream << ',';
+			aStream << '"' << getPhaseName((Phase) nPhase) << "\":";
+			HistogramToJson(m_aPhases[nPhase], aStream);
+		}
+		aStream << "}}";
+	}
+	sResult += aStream.str();
+}
+
+LayoutStats* LayoutStats::forIdentifier( std::string const& sIdentifier )
+{
+	StatsMap& aMap = GetStatsMap();
+	StatsLock aLock;
+
+	StatsMap::iterator it = aMap.find(sIdentifier);
+	if(it != aMap.end())
+		return it->second;
+
+	LayoutStats* pStats = new LayoutStats(sIdentifier);
+	aMap[sIdentifier] = pStats;
+	return pStats;
+}
+
+void LayoutStats::dumpAllJson( std::string& sResult )
+{
+	std::vector<LayoutStats const*> vStats;
+	{
+		StatsMap& aMap = GetStatsMap();
+		StatsLock aLock;
+		for(StatsMap::const_iterator it = aMap.begin(); it != aMap.end(); ++it)
+			vStats.push_back(it->second);
+	}
+
+	sResult += '[';
+	for(size_t nIndex = 0; nIndex < vStats.size(); ++nIndex)
+	{
+		if(nIndex > 0)
+			sResult += ',';
+		vStats[nIndex]->toJson(sResult);
+	}
+	sResult += ']';
+}
+
+/***************************************************************
+                          PhaseClock
+ **************************************************************/
+
+PhaseClock::PhaseClock( LayoutStats* pStats ) :
+	m_pStats(pStats),
+	m_nLastTick(0)
+{
+	for(int nPhase = 0; nPhase < LayoutStats::PhaseCount; ++nPhase)
+	{
+		m_aPhaseTicks[nPhase] = 0;
+		m_aPhaseEntered[nPhase] = false;
+	}
+}
+
+void PhaseClock::creditCurrent( boost::int64_t nNow )
+{
+	if(!m_vStack.empty())
+		m_aPhaseTicks[m_vStack.back()] += nNow - m_nLastTick;
+	m_nLastTick = nNow;
+}
+
+void PhaseClock::enter( LayoutStats::Phase nPhase )
+{
+	creditCurrent(Now());
+	m_vStack.push_back(nPhase);
+	m_aPhaseEntered[nPhase] = true;
+}
+
+void PhaseClock::leave()
+{
+	AFXASSUME(!m_vStack.empty());
+	creditCurrent(Now());
+	m_vStack.pop_back();
+}
+
+void PhaseClock::endPass()
+{
+	// A pass may be ended from within another one, e.g. if update() triggers a synchronous draw()
+	if(!m_vStack.empty())
+		return;
+
+	double adPhaseUs[LayoutStats::PhaseCount];
+	bool bAnyEntered = false;
+	for(int nPhase = 0; nPhase < LayoutStats::PhaseCount; ++nPhase)
+	{
+		adPhaseUs[nPhase] = TicksToUs(m_aPhaseTicks[nPhase]);
+		bAnyEntered |= m_aPhaseEntered[nPhase];
+	}
+
+	if(bAnyEntered)
+		m_pStats->addPass(adPhaseUs, m_aPhaseEntered);
+
+	for(int nPhase = 0; nPhase < LayoutStats::PhaseCount; ++nPhase)
+	{
+		m_aPhaseTicks[nPhase] = 0;
+		m_aPhaseEntered[nPhase] = false;
+	}
+}
@@ -0,0 +1,50 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/layoutcache.h"
+
+using namespace Layout;
+
+bool LayoutCache::Key::operator==( Key const& rhs ) const
+{
+	return rctRoot == rhs.rctRoot
+		&& rctWindowClient == rhs.rctWindowClient
+		&& vnFolded == rhs.vnFolded
+		&& vSplitters == rhs.vSplitters;
+}
+
+LayoutCache::LayoutCache( size_t nCapacity ) :
+	m_nCapacity(nCapacity),
+	m_nGeneration(0)
+{
+}
+
+LayoutCache::Result const* LayoutCache::find( Key const& aKey )
+{
+	for(std::list<Entry>::iterator it = m_lstEntries.begin(); it != m_lstEntries.end(); ++it)
+	{
+		if(it->first == aKey)
+		{
+			m_lstEntries.splice(m_lstEntries.begin(), m_lstEntries, it);
+			return &m_lstEntries.front().second;
+		}
+	}
+	return NULL;
+}
+
+void LayoutCache::store( Key const& aKey, Result const& aResult )
+{
+	if(m_nCapacity == 0)
+		return;
+
+	while(m_lstEntries.size() >= m_nCapacity)
+		m_lstEntries.pop_back();
+
+	m_lstEntries.push_front(Entry(aKey, aResult));
+}
+
+void LayoutCache::clear()
+{
+	m_lstEntries.clear();
+	++m_nGeneration;
+}
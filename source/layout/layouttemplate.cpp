@@ -0,0 +1,108 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/layouttemplate.h"
+
+#include <map>
+
+using namespace Layout;
+
+namespace
+{
+/** Guards the template registry, which may be used by dialogs on different threads. */
+class TemplateLock
+{
+public:
+	TemplateLock() { ::EnterCriticalSection(&s_aSection); }
+	~TemplateLock() { ::LeaveCriticalSection(&s_aSection); }
+
+	static void init() { ::InitializeCriticalSection(&s_aSection); }
+
+private:
+	static CRITICAL_SECTION s_aSection;
+};
+
+CRITICAL_SECTION TemplateLock::s_aSection;
+
+typedef std::map<std::string, LayoutTemplate::Ptr> TemplateMap;
+
+/** The registry is never destroyed, managers may still be alive while static objects are torn down. */
+TemplateMap& GetTemplateMap()
+{
+	static TemplateMap* s_pMap = NULL;
+	if(!s_pMap)
+	{
+		TemplateLock::init();
+		s_pMap = new TemplateMap();
+	}
+	return *s_pMap;
+}
+
+/** Creates the registry and its lock while the library is loaded, before any second thread can ask for it. */
+struct TemplateMapInit
+{
+	TemplateMapInit() { GetTemplateMap(); }
+} s_aTemplateMapInit;
+}
+
+LayoutTemplate::LayoutTemplate( Description const& aDescription, std::vector<int> const& vFingerprint, std::vector<SIZE> const& vMinSizes, std::string const& sText /*= std::string()*/ ) :
+	m_aDescription(aDescription),
+	m_sText(sText),
+	m_vFingerprint(vFingerprint),
+	m_vMinSizes(vMinSizes)
+{
+}
+
+LayoutTemplate::Ptr LayoutTemplate::find( std::string const& sIdentifier )
+{
+	TemplateMap& aMap = GetTemplateMap();
+	TemplateLock aLock;
+
+	TemplateMap::const_iterator it = aMap.find(sIdentifier);
+	return it != aMap.end() ? it->second : Ptr();
+}
+
+void LayoutTemplate::publish( std::string const& sIdentifier, Ptr pTemplate )
+{
+	TemplateMap& aMap = GetTemplateMap();
+	TemplateLock aLock;
+	aMap[sIdentifier] = pTemplate;
+}
+
+LayoutTemplate::Ptr LayoutTemplate::forDescription( std::string const& sIdentifier, char const* pchText, std::string* psError /*= NULL*/ )
+{
+	std::string sText(pchText ? pchText : "");
+
+	// Unnamed layouts of different windows would share one entry
+	Ptr pExisting;
+	if(!sIdentifier.empty())
+		pExisting = find(sIdentifier);
+	if(pExisting && pExisting->getDescription().getControlCount() > 0 && pExisting->getText() == sText)
+		return pExisting;
+
+	// Parsed outside of the lock. Two first instances may both parse, the last one wins.
+	Description aDescription;
+	if(!aDescription.parse(pchText, psError))
+		return Ptr();
+
+	// The min sizes stay guarded by their fingerprint, they are kept even if the text changed
+	std::vector<int> vFingerprint;
+	std::vector<SIZE> vMinSizes;
+	if(pExisting)
+	{
+		vFingerprint = pExisting->m_vFingerprint;
+		vMinSizes = pExisting->m_vMinSizes;
+	}
+
+	Ptr pTemplate(new LayoutTemplate(aDescription, vFingerprint, vMinSizes, sText));
+	if(!sIdentifier.empty())
+		publish(sIdentifier, pTemplate);
+	return pTemplate;
+}
+
+void LayoutTemplate::clearAll()
+{
+	TemplateMap& aMap = GetTemplateMap();
+	TemplateLock aLock;
+	aMap.clear();
+}
@@ -11,11 +11,15 @@
 #include "../../GlobExport/editor.h"
 #include "../../GlobExport/geometry.h"
 #include "../../GlobExport/profile.h"
+#include "../../GlobExport/instrumentation.h"
+#include "../../GlobExport/trace.h"
+#include "../../GlobExport/replay.h"
 
 #include "ArchiveUtil/GlobExport/ArchiveUtil.hpp"
 
 #include <assert.h>
 #include <boost/filesystem.hpp>
+#include <boost/static_assert.hpp>
 #include <stdlib.h>
 using namespace Layout;
 
@@ -45,6 +49,24 @@ Manager::Manager( HWND hParent, const SIZE& hMinSize, const SIZE& hMaxSize ) :
 	m_pSuperWndProc(NULL),
 	m_pModalPage(NULL),
 	m_pHoveredArea(NULL),
+	m_pHitTestIndex(NULL),
+	m_pVirtualControlHost(NULL),
+	m_ptViewportOrigin(0, 0),
+	m_rctWindowClient(0, 0, 0, 0),
+	m_pLayoutCache(NULL),
+	m_nTransactionDepth(0),
+	m_bOrigRectsPending(false),
+	m_bRedrawSuspended(false),
+	m_bViewportMode(false),
+	m_bMinTrackWidth(true),
+	m_bMinTrackHeight(true),
+	m_aPassCounters(),
+	m_pPhaseClock(NULL),
+	m_pOwnStats(NULL),
+	m_pMessageRecorder(NULL),
+	m_nSplitterDragMode(Splitter::DragLive),
+	m_nSplitterDragInterval(0),
+	m_pCapturedSplitter(NULL),
 	m_pEditor(NULL)
 {
 	initMgr(hParent, hMaxSize, hMinSize);
@@ -65,6 +87,24 @@ Manager::Manager( HWND hParent, std::string sLayoutIdentifier, ULONG nProfileMod
 	m_pSuperWndProc(NULL),
 	m_pModalPage(NULL),
 	m_pHoveredArea(NULL),
+	m_pHitTestIndex(NULL),
+	m_pVirtualControlHost(NULL),
+	m_ptViewportOrigin(0, 0),
+	m_rctWindowClient(0, 0, 0, 0),
+	m_pLayoutCache(NULL),
+	m_nTransactionDepth(0),
+	m_bOrigRectsPending(false),
+	m_bRedrawSuspended(false),
+	m_bViewportMode(false),
+	m_bMinTrackWidth(true),
+	m_bMinTrackHeight(true),
+	m_aPassCounters(),
+	m_pPhaseClock(NULL),
+	m_pOwnStats(NULL),
+	m_pMessageRecorder(NULL),
+	m_nSplitterDragMode(Splitter::DragLive),
+	m_nSplitterDragInterval(0),
+	m_pCapturedSplitter(NULL),
 	m_pEditor(NULL)
 {
 	initMgr(hParent, hMaxSize, hMinSize);
@@ -77,12 +117,20 @@ Manager::~Manager()
 {
 	eraseFromManagedMap();
 
-	// Clean up all Control instances
+	// Clean up all Control instances. Materialized virtual controls are in both lists.
 	for each( std::pair<HWND, Control*> hPair in m_mapHwndControl )
-		delete hPair.second;
+		if( !hPair.second->isVirtual() )
+			delete hPair.second;
+
+	for each( Control* pCtrl in m_vVirtualControls )
+		delete pCtrl;
 
 	// Delete Alignment Areas
 	delete m_pMainArea;
+	delete m_pHitTestIndex;
+	delete m_pLayoutCache;
+	delete m_pPhaseClock;
+	delete m_pOwnStats;
 }
 
 /**
@@ -97,9 +145,19 @@ Manager::~Manager()
  * the controls current rect will be seen as its original one!
  */
 bool Manager::addControl( HWND hCtrl, Align::Mode& hAlignHorz, Align::Mode& hAlignVert, std::string sName )
+{
+	return addControl(hCtrl, hAlignHorz.getSlot(), hAlignVert.getSlot(), sName);
+}
+
+/**
+ * Add a control with alignment slots. Built-in alignments are stored by value
+ * in the control, custom modes of the slots are copied.
+ */
+bool Manager::addControl( HWND hCtrl, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName )
 {
 	// first check whether the control is any of the background controls of the alignment areas
-	if(m_pMainArea->isBackgroundHwnd(hCtrl) != NULL)
+	Area* pBackgroundArea = DYNAMIC_DOWNCAST(Area, CWnd::FromHandlePermanent(hCtrl));
+	if(pBackgroundArea != NULL && pBackgroundArea->getManager() == this)
 		return false;
 
 	// create a new map entry and remember the iterator
@@ -111,20 +169,247 @@ bool Manager::addControl( HWND hCtrl, Align::Mode& hAlignHorz, Align::Mode& hAli
 	if( (*it).second )
 	{
 		(*it).second->updateOrigRect();
-		(*it).second->setHorzAlignment(hAlignHorz.copy());
-		(*it).second->setVertAlignment(hAlignVert.copy());
+		(*it).second->setHorzAlignment(aAlignHorz);
+		(*it).second->setVertAlignment(aAlignVert);
 		return false;
 	}
 	else
 	{
 		// create the new Control and assign it to the iterator
-		Control* pAlignedControl = new Control(this, hCtrl, hAlignHorz, hAlignVert, sName);
+		Control* pAlignedControl = new Control(this, hCtrl, aAlignHorz, aAlignVert, sName);
 		(*it).second = pAlignedControl;
-		m_pMainArea->insertIfOwned(pAlignedControl);
+
+		Area* pArea = findOwnerArea(pAlignedControl);
+		if(pArea)
+			pArea->attachControl(pAlignedControl);
 		return true;
 	}
 }
 
+size_t Manager::addControls( ControlSpec const* pSpecs, size_t nCount )
+{
+	std::vector<ControlSpec const*> vNewSpecs;
+	std::vector<std::map<HWND, Control*>::iterator> vNewEntries;
+	vNewSpecs.reserve(nCount);
+	vNewEntries.reserve(nCount);
+
+	for(size_t i = 0; i < nCount; ++i)
+	{
+		ControlSpec const& aSpec = pSpecs[i];
+		Area* pBackgroundArea = DYNAMIC_DOWNCAST(Area, CWnd::FromHandlePermanent(aSpec.hCtrl));
+		if(pBackgroundArea != NULL && pBackgroundArea->getManager() == this)
+			continue;
+
+		std::pair<std::map<HWND, Control*>::iterator, bool> aInsert = m_mapHwndControl.insert(std::make_pair(aSpec.hCtrl, (Control*) NULL));
+		if(aInsert.second)
+		{
+			vNewSpecs.push_back(&aSpec);
+			vNewEntries.push_back(aInsert.first);
+		}
+		else if(aInsert.first->second)
+		{
+			aInsert.first->second->updateOrigRect();
+			aInsert.first->second->setHorzAlignment(aSpec.aHorz);
+			aInsert.first->second->setVertAlignment(aSpec.aVert);
+		}
+	}
+
+	if(vNewSpecs.empty())
+		return 0;
+
+	// Read all window rects, then map them to client coords in one call
+	std::vector<CRect> vRects(vNewSpecs.size());
+	for(size_t i = 0; i < vNewSpecs.size(); ++i)
+		::GetWindowRect(vNewSpecs[i]->hCtrl, &vRects[i]);
+	::MapWindowPoints(NULL, m_hManagedWindow, (LPPOINT) &vRects[0], (UINT) vRects.size() * 2);
+
+	std::vector<Control*> vControls;
+	vControls.reserve(vNewSpecs.size());
+	for(size_t i = 0; i < vNewSpecs.size(); ++i)
+	{
+		vRects[i].OffsetRect(m_ptViewportOrigin);
+		Control* pAlignedControl = new Control(this, vNewSpecs[i]->hCtrl, vNewSpecs[i]->aHorz, vNewSpecs[i]->aVert, vNewSpecs[i]->sName, vRects[i]);
+		vNewEntries[i]->second = pAlignedControl;
+		vControls.push_back(pAlignedControl);
+	}
+
+	// Controls outside of the main area stay unattached, like with addControl()
+	size_t nAdded = vControls.size();
+	m_pMainArea->insertOwned(vControls);
+	return nAdded;
+}
+
+/**
+ * Add a virtual control. It is aligned like any other control, but has no window
+ * unless it intersects the visible client rect of the managed window.
+ */
+Control const* Manager::addVirtualControl( UINT_PTR nKey, CRect const& rctOrig, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName )
+{
+	Control* pCtrl = new Control(this, nKey, rctOrig, aAlignHorz, aAlignVert, sName);
+	m_vVirtualControls.push_back(pCtrl);
+
+	Area* pArea = findOwnerArea(pCtrl);
+	if(pArea)
+		pArea->attachControl(pCtrl);
+
+	CRect rctVisible;
+	getViewportRect(rctVisible);
+	updateVirtualControl(pCtrl, rctVisible);
+
+	return pCtrl;
+}
+
+void Manager::updateVirtualControl( Control* pCtrl, CRect const& rctVisible )
+{
+	CRect rctIntersection;
+	bool bInView = !pCtrl->m_bVirtualHidden && rctIntersection.IntersectRect(&pCtrl->m_rctCurrent, &rctVisible);
+
+	if(bInView && !pCtrl->m_hID && m_pVirtualControlHost)
+	{
+		CRect rctClient(pCtrl->m_rctCurrent);
+		rctClient.OffsetRect(-m_ptViewportOrigin);
+
+		HWND hWnd = m_pVirtualControlHost->materialize(pCtrl, pCtrl->m_nKey, rctClient);
+		if(hWnd)
+		{
+			pCtrl->m_hID = hWnd;
+			pCtrl->m_rctApplied = pCtrl->m_rctCurrent;
+			m_mapHwndControl[hWnd] = pCtrl;
+		}
+	}
+	else if(!bInView && pCtrl->m_hID)
+	{
+		HWND hWnd = pCtrl->m_hID;
+		pCtrl->m_hID = NULL;
+		m_mapHwndControl.erase(hWnd);
+
+		if(m_pVirtualControlHost)
+			m_pVirtualControlHost->dematerialize(pCtrl, pCtrl->m_nKey, hWnd);
+	}
+}
+
+void Manager::setViewportMode( bool bEnable )
+{
+	m_bViewportMode = bEnable;
+	if(!bEnable)
+		flushPendingControls(true);
+}
+
+void Manager::setSplitterDragMode( Splitter::DragMode nMode, UINT nFramesPerSecond /*= 30*/ )
+{
+	m_nSplitterDragMode = nMode;
+	m_nSplitterDragInterval = nFramesPerSecond ? 1000 / nFramesPerSecond : 0;
+}
+
+void Manager::getViewportRect( CRect& rctResult ) const
+{
+	rctResult = m_rctWindowClient;
+	rctResult.OffsetRect(m_ptViewportOrigin);
+}
+
+/**
+ * Scroll the managed window to a new viewport origin. The children are moved
+ * as a whole, which is what keeps scrolling cheap for large layouts.
+ */
+void Manager::scrollViewport( POINT ptOrigin )
+{
+	CPoint ptDelta(m_ptViewportOrigin.x - ptOrigin.x, m_ptViewportOrigin.y - ptOrigin.y);
+	if(ptDelta.x == 0 && ptDelta.y == 0)
+		return;
+
+	m_ptViewportOrigin = ptOrigin;
+	::ScrollWindowEx(m_hManagedWindow, ptDelta.x, ptDelta.y, NULL, NULL, NULL, NULL, SW_SCROLLCHILDREN|SW_INVALIDATE|SW_ERASE);
+
+	// Controls which were out of view during the last layout pass are still at their old rect
+	flushPendingControls(false);
+
+	if(!m_vVirtualControls.empty())
+	{
+		CRect rctVisible;
+		getViewportRect(rctVisible);
+		for each(Control* pCtrl in m_vVirtualControls)
+			updateVirtualControl(pCtrl, rctVisible);
+	}
+}
+
+void Manager::deferControl( Control* pCtrl )
+{
+	// A control which is still listed may have been applied in the meantime,
+	// flushPendingControls() drops such entries.
+	if(!pCtrl->m_bLayoutPending)
+	{
+		pCtrl->m_bLayoutPending = true;
+		m_vPendingControls.push_back(pCtrl);
+	}
+	++m_aPassCounters.nDeferred;
+}
+
+void Manager::flushPendingControls( bool bAll )
+{
+	if(m_vPendingControls.empty())
+		return;
+
+	CRect rctViewport;
+	getViewportRect(rctViewport);
+
+	HDWP windowPosHandle = BeginDeferWindowPos(m_vPendingControls.size());
+	for(size_t nIndex = 0; nIndex < m_vPendingControls.size();)
+	{
+		Control* pCtrl = m_vPendingControls[nIndex];
+		CRect rctIntersection;
+
+		if(pCtrl->m_bLayoutPending)
+		{
+			if(!bAll && !rctIntersection.IntersectRect(&pCtrl->m_rctCurrent, &rctViewport))
+			{
+				++nIndex;
+				continue;
+			}
+			if(!(windowPosHandle = pCtrl->apply(windowPosHandle)))
+				break;
+		}
+
+		// The order of the pending controls is irrelevant, so the gap is filled with the last one
+		m_vPendingControls[nIndex] = m_vPendingControls.back();
+		m_vPendingControls.pop_back();
+	}
+	LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseApply);
+	if(windowPosHandle)
+		EndDeferWindowPos(windowPosHandle);
+}
+
+Area* Manager::findOwnerArea( Control* pCtrl ) const
+{
+	std::vector<HitTestIndex::Element> vCandidates;
+	m_pHitTestIndex->queryContaining(pCtrl->getRect(), vCandidates);
+	for each(HitTestIndex::Element const& aElement in vCandidates)
+		if(aElement.nKind == HitTestIndex::KindArea && aElement.pArea->isControlInRect(pCtrl))
+			return aElement.pArea;
+
+	// The control is in no leaf area. Find the deepest area containing it.
+	Area* pArea = m_pMainArea;
+	if(!pArea->isControlInRect(pCtrl))
+		return NULL;
+
+	while(pArea->isParentArea())
+	{
+		Area* pChild = NULL;
+		for each(Area* pCandidate in pArea->m_vChildren)
+		{
+			if(pCandidate->isControlInRect(pCtrl))
+			{
+				pChild = pCandidate;
+				break;
+			}
+		}
+		if(!pChild)
+			break;
+		pArea = pChild;
+	}
+
+	return pArea;
+}
+
 /**
  * Add a dialog item with a specific alignment to be enforced by this manager.
  * @param nID The dialog item ID of the control to be added
@@ -146,6 +431,16 @@ bool Manager::addControl( UINT nID, Align::Mode& hAlignHorz, Align::Mode& hAlign
 	return false;
 }
 
+bool Manager::addControl( UINT nID, Align::Slot const& aAlignHorz, Align::Slot const& aAlignVert, std::string sName )
+{
+	HWND hCtrl = ::GetDlgItem(m_hManagedWindow, nID);
+
+	if( hCtrl )
+		return this->addControl(hCtrl, aAlignHorz, aAlignVert, sName);
+
+	return false;
+}
+
 
 /**
  * Remove a control whose alignment is not be enforced by this manager anymore.
@@ -159,9 +454,11 @@ bool Manager::removeControl( HWND hCtrl )
 
 	if( it != m_mapHwndControl.end() )
 	{
-		if(it->second->getArea())
-			const_cast<Area*>(it->second->getArea())->removeControl(it->second);
+		// A materialized virtual control is owned by the virtual list, not by its window
+		if(it->second->isVirtual())
+			return removeVirtualControl(it->second);
 
+		detachControl(it->second);
 		m_mapHwndControl.erase(it);
 		return true;
 	}
@@ -169,6 +466,73 @@ bool Manager::removeControl( HWND hCtrl )
 		return false;
 }
 
+bool Manager::removeVirtualControl( Control const* pCtrl )
+{
+	std::vector<Control*>::iterator it = std::find(m_vVirtualControls.begin(), m_vVirtualControls.end(), pCtrl);
+	if(it == m_vVirtualControls.end())
+		return false;
+
+	Control* pControl = *it;
+	m_vVirtualControls.erase(it);
+	detachControl(pControl);
+
+	if(pControl->m_hID)
+	{
+		HWND hWnd = pControl->m_hID;
+		pControl->m_hID = NULL;
+		m_mapHwndControl.erase(hWnd);
+
+		if(m_pVirtualControlHost)
+			m_pVirtualControlHost->dematerialize(pControl, pControl->m_nKey, hWnd);
+	}
+
+	delete pControl;
+	return true;
+}
+
+void Manager::detachControl( Control* pCtrl )
+{
+	if(pCtrl->getArea())
+		const_cast<Area*>(pCtrl->getArea())->removeControl(pCtrl);
+
+	m_pHitTestIndex->remove(HitTestIndex::Element(HitTestIndex::KindControl, pCtrl));
+	m_vPendingControls.erase(std::remove(m_vPendingControls.begin(), m_vPendingControls.end(), pCtrl), m_vPendingControls.end());
+	m_vTransactionControls.erase(std::remove(m_vTransactionControls.begin(), m_vTransactionControls.end(), pCtrl), m_vTransactionControls.end());
+}
+
+bool Manager::setControlVisible( HWND hCtrl, bool bVisible )
+{
+	std::map<HWND, Control*>::iterator it = m_mapHwndControl.find(hCtrl);
+	if( it == m_mapHwndControl.end() || it->second->isVirtual() )
+		return false;
+
+	// A control in a hidden or folded area only notes the visibility for temporaryShow()
+	Control* pCtrl = it->second;
+	Area const* pArea = pCtrl->getArea();
+	pCtrl->m_bVisibilityBeforeTempHide = bVisible;
+	if(!pArea || (pArea->m_bVisible && !pArea->isFolded(Splitter::Horizontal) && !pArea->isFolded(Splitter::Vertical)))
+		pCtrl->m_bShown = bVisible;
+
+	// The min sizes and memoized passes depend on which controls are shown
+	pCtrl->alignmentChanged();
+
+	if(isInTransaction())
+		m_vTransactionControls.push_back(pCtrl);
+	else
+		applyVisibility(std::vector<Control*>(1, pCtrl));
+	return true;
+}
+
+bool Manager::setControlVisible( UINT nID, bool bVisible )
+{
+	HWND hCtrl = ::GetDlgItem(m_hManagedWindow, nID);
+
+	if( hCtrl )
+		return setControlVisible(hCtrl, bVisible);
+
+	return false;
+}
+
 /**
  * Get the Alignment of a control that supposedly has been added to the manager.
  * @param hAlignHorz [out]
@@ -181,8 +545,13 @@ bool Manager::getControlAlignment( CWnd* pCtrl, Align::Mode& hAlignHorz, Align::
 
 	if( it != m_mapHwndControl.end() )
 	{
-		hAlignHorz = *((*it).second->getHorzAlignment());
-		hAlignVert = *((*it).second->getVertAlignment());
+		// Reading must not turn built-in alignments into custom ones, see Control::getHorzAlignment()
+		Align::Mode* pHorz = (*it).second->getHorzSlot().createMode();
+		Align::Mode* pVert = (*it).second->getVertSlot().createMode();
+		hAlignHorz = *pHorz;
+		hAlignVert = *pVert;
+		delete pHorz;
+		delete pVert;
 		return true;
 	}
 	else
@@ -194,20 +563,56 @@ bool Manager::getControlAlignment( CWnd* pCtrl, Align::Mode& hAlignHorz, Align::
  */
 void Manager::update()
 {
+	update(false);
+}
+
+void Manager::update( bool bForce )
+{
+	// The pass is run by the outermost commit()
+	if (m_nTransactionDepth > 0)
+		return;
+
 	if (::IsWindow(getWnd()->GetSafeHwnd()))
 	{
-		// update current size member
-		CRect currentRect;
-		getWnd()->GetWindowRect(currentRect);
+		m_aPassCounters = PassCounters();
+
+		{
+			LAYOUT_TRACE_SCOPE("Manager::update");
+			LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseUpdate);
+
+			// update current size member
+			CRect currentRect;
+			getWnd()->GetWindowRect(currentRect);
+			::GetClientRect(m_hManagedWindow, &m_rctWindowClient);
+
+			if(!m_pMainArea->hasMinMaxSize())
+				prepareMinSizes();
+
+			// Update the alignment areas (Recursively). Area::update() returns at once if the size did not change.
+			if(bForce)
+			{
+				m_pMainArea->updateMinSize();
+				m_pMainArea->resizeAndAutoFoldIfNecessary(currentRect, true);
+			}
+			else if(m_pLayoutCache && currentRect != m_pMainArea->m_rctCurrentShape)
+				updateFromLayoutCache(currentRect);
+			else
+				m_pMainArea->update(currentRect);
 
-		// Update the alignment areas (Recursively)
-		m_pMainArea->update(currentRect);
+			// Controls which were deferred before may be in view after a resize
+			if(m_bViewportMode)
+				flushPendingControls(false);
+		}
+		LAYOUT_END_PASS(m_pPhaseClock);
 	}
 }
 
 void Layout::Manager::clampRect(UINT nSide, LPRECT lpRect)
 {
 	CRect currentRect(lpRect);
+	if (!m_pMainArea->hasMinMaxSize())
+		prepareMinSizes();
+
 	if (m_pMainArea->clampRect(nSide, currentRect))
 	{
 		lpRect->top = currentRect.top;
@@ -217,12 +622,36 @@ void Layout::Manager::clampRect(UINT nSide, LPRECT lpRect)
 	}
 }
 
+void Manager::getMinMaxInfo( MINMAXINFO* pInfo )
+{
+	if (!m_pMainArea->hasMinMaxSize())
+		prepareMinSizes();
+
+	SIZE const& szMin = m_pMainArea->getMinSize();
+	SIZE const& szMax = m_pMainArea->getMaxSize();
+	if (CSize(szMin) == CSize(szMax))
+		return;
+
+	if (m_bMinTrackWidth)
+		pInfo->ptMinTrackSize.x = std::max(pInfo->ptMinTrackSize.x, szMin.cx);
+	if (m_bMinTrackHeight)
+		pInfo->ptMinTrackSize.y = std::max(pInfo->ptMinTrackSize.y, szMin.cy);
+
+	// Like Area::clampRect(), a max size below the min size is ignored
+	if (szMin.cx <= szMax.cx)
+		pInfo->ptMaxTrackSize.x = std::min(pInfo->ptMaxTrackSize.x, szMax.cx);
+	if (szMin.cy <= szMax.cy)
+		pInfo->ptMaxTrackSize.y = std::min(pInfo->ptMaxTrackSize.y, szMax.cy);
+}
+
 Splitter const* Manager::putSplitter( HWND hHigherCtrl, HWND hLowerCtrl, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment )
 {
-	Control* pHiCtrl = m_mapHwndControl[hHigherCtrl];
-	Control* pLoCtrl = m_mapHwndControl[hLowerCtrl];
+	return putSplitter(m_mapHwndControl[hHigherCtrl], m_mapHwndControl[hLowerCtrl], nOrientation, nAlignment);
+}
 
-	if(pHiCtrl && pLoCtrl)
+Splitter const* Manager::putSplitter( Control const* pHiCtrl, Control const* pLoCtrl, Splitter::Orientation nOrientation, Splitter::SplitterAlignment nAlignment )
+{
+	if(pHiCtrl && pLoCtrl && pHiCtrl->getArea())
 		return const_cast<Area*>(pHiCtrl->getArea())->putSplitter(pHiCtrl, pLoCtrl, nOrientation, nAlignment);
 	else
 		return NULL;
@@ -249,9 +678,10 @@ Splitter const* Manager::putSplitter( AreaProperties& aHi, AreaProperties& aLo,
 	// Adapt the area property values
 	if(pSplitter)
 	{
+		// The children next to the splitter, the area may have been split before
 		Area const* pArea = pSplitter->getArea();
-		Area const* pHi = pArea->getChildHi();
-		Area const* pLo = pArea->getChildLo();
+		Area const* pHi = pArea->getChild(pSplitter->getIndex());
+		Area const* pLo = pArea->getChild(pSplitter->getIndex() + 1);
 		AFXASSUME(pHi != NULL && pLo != NULL);
 		if(pHi && pLo)
 		{
@@ -263,11 +693,457 @@ Splitter const* Manager::putSplitter( AreaProperties& aHi, AreaProperties& aLo,
 	return pSplitter;
 }
 
+void Manager::setGrid( Area const* pArea, Tracks const& aColumns, Tracks const& aRows )
+{
+	Area* pGrid = const_cast<Area*>(pArea ? pArea : m_pMainArea);
+	pGrid->setTracks(Align::Horizontal, aColumns);
+	pGrid->setTracks(Align::Vertical, aRows);
+}
+
+namespace
+{
+	/** Orders controls by the left edge of their orig rect, for a horizontal stack. */
+	bool IsLeftOf(Control const* pLhs, Control const* pRhs)
+	{
+		return pLhs->getOrigRect().left < pRhs->getOrigRect().left;
+	}
+
+	/** Orders controls by the top edge of their orig rect, for a vertical stack. */
+	bool IsAbove(Control const* pLhs, Control const* pRhs)
+	{
+		return pLhs->getOrigRect().top < pRhs->getOrigRect().top;
+	}
+}
+
+void Manager::setStack( Area const* pArea, Align::Dimension nDim, int iGap )
+{
+	Area* pStack = const_cast<Area*>(pArea ? pArea : m_pMainArea);
+
+	std::vector<Control*> vControls(pStack->getControls());
+	std::stable_sort(vControls.begin(), vControls.end(), nDim == Align::Horizontal ? &IsLeftOf : &IsAbove);
+
+	Tracks aTracks(iGap);
+	for(size_t nIndex = 0; nIndex < vControls.size(); ++nIndex)
+	{
+		aTracks.add(Tracks::KindAuto);
+
+		Control* pCtrl = vControls[nIndex];
+		Control::assignSlot(nDim == Align::Horizontal ? pCtrl->m_aHorzAlign : pCtrl->m_aVertAlign, Align::Track::slot((int) nIndex), false);
+		pCtrl->alignmentChanged();
+	}
+
+	pStack->setTracks(nDim, aTracks);
+}
+
+namespace
+{
+	/** Maps a Description::AlignKind to the alignment slot of the built-in mode. */
+	Align::Slot DescribedAlignment(boost::uint16_t nKind, boost::uint16_t nMinSize)
+	{
+		switch(nKind)
+		{
+		case Description::AlignResize: return Align::Slot(Align::KindResize, nMinSize ? nMinSize : Align::Resize::iDefaultMinSize);
+		case Description::AlignFit: return Align::Slot(Align::KindFit);
+		case Description::AlignBottomRight: return Align::Slot(Align::KindBottomRight);
+		case Description::AlignRelative: return Align::Slot(Align::KindRelative);
+		case Description::AlignRelativeResize: return Align::Slot(Align::KindRelativeResize);
+		default: return Align::Slot(Align::KindTopLeft);
+		}
+	}
+
+	/** Counts the splitters of an area tree. */
+	size_t CountSplitters(Area const* pArea)
+	{
+		size_t nResult = pArea->getSplitterCount();
+		for(size_t i = 0; i < pArea->getChildCount(); ++i)
+			nResult += CountSplitters(pArea->getChild(i));
+		return nResult;
+	}
+
+	/** Applies an area statement of a description to a set of area properties. */
+	void ApplyAreaEntry(Description const& aDescription, Description::AreaEntry const& aEntry, AreaProperties& aProps)
+	{
+		aProps.setStyle(aEntry.nStyle);
+		aProps.setName(aDescription.getString(aEntry.nTitle));
+		aProps.setColor(AreaStyleDrawBk, aEntry.crBk);
+		aProps.setColor(AreaStyleHover, aEntry.crHover);
+		aProps.setColor(AreaStyleDrawTitle, aEntry.crText);
+		aProps.setColor(AreaStyleHoverTitle, aEntry.crHoverText);
+	}
+}
+
+bool Manager::applyDescription( Description const& aDescription )
+{
+	BOOST_STATIC_ASSERT((int) Description::SplitHorizontal == (int) Splitter::Horizontal);
+	BOOST_STATIC_ASSERT((int) Description::SplitVertical == (int) Splitter::Vertical);
+	BOOST_STATIC_ASSERT((int) Description::SplitAlignHigh == (int) Splitter::AlignHigh);
+	BOOST_STATIC_ASSERT((int) Description::SplitAlignLow == (int) Splitter::AlignLow);
+	BOOST_STATIC_ASSERT((int) Description::SplitAlignRelative == (int) Splitter::AlignRelative);
+	BOOST_STATIC_ASSERT((int) Description::StyleFoldable == (int) AreaStyleFoldable);
+	BOOST_STATIC_ASSERT((int) Description::StyleDrawLeftLine == (int) AreaStyleDrawLeftLine);
+
+	size_t nControls = aDescription.getControlCount();
+	bool bResult = true;
+
+	// Resolve all item handles and the area statement of each control up front
+	std::vector<HWND> vHandles(nControls, (HWND) NULL);
+	std::vector<Description::AreaEntry const*> vAreaOfControl(nControls, (Description::AreaEntry const*) NULL);
+
+	for(size_t i = 0; i < aDescription.getAreaCount(); ++i)
+		vAreaOfControl[aDescription.getArea(i).nControl] = &aDescription.getArea(i);
+
+	std::vector<ControlSpec> vSpecs;
+	vSpecs.reserve(nControls);
+	for(size_t i = 0; i < nControls; ++i)
+	{
+		Description::ControlEntry const& aEntry = aDescription.getControl(i);
+		vHandles[i] = ::GetDlgItem(m_hManagedWindow, aEntry.nId);
+
+		if(vHandles[i])
+			vSpecs.push_back(ControlSpec(
+				vHandles[i],
+				DescribedAlignment(aEntry.nHorz, aEntry.nHorzMin),
+				DescribedAlignment(aEntry.nVert, aEntry.nVertMin),
+				aDescription.getString(aEntry.nName)
+			));
+		else
+			bResult = false;
+	}
+	addControls(vSpecs);
+
+	for(size_t i = 0; i < aDescription.getSplitterCount(); ++i)
+	{
+		Description::SplitterEntry const& aEntry = aDescription.getSplitter(i);
+		if(!vHandles[aEntry.nHigh] || !vHandles[aEntry.nLow])
+		{
+			bResult = false;
+			continue;
+		}
+
+		AreaProperties aHi, aLo;
+		if(vAreaOfControl[aEntry.nHigh])
+			ApplyAreaEntry(aDescription, *vAreaOfControl[aEntry.nHigh], aHi);
+		if(vAreaOfControl[aEntry.nLow])
+			ApplyAreaEntry(aDescription, *vAreaOfControl[aEntry.nLow], aLo);
+		aHi.setControl(vHandles[aEntry.nHigh]);
+		aLo.setControl(vHandles[aEntry.nLow]);
+
+		if(!putSplitter(aHi, aLo, (Splitter::Orientation) aEntry.nOrientation, (Splitter::SplitterAlignment) aEntry.nAlignment))
+			bResult = false;
+	}
+
+	return bResult;
+}
+
+bool Manager::matchesDescription( Description const& aDescription ) const
+{
+	size_t nWindowed = 0;
+	for each(std::pair<HWND, Control*> const& aPair in m_mapHwndControl)
+		if(!aPair.second->isVirtual())
+			++nWindowed;
+
+	if(nWindowed != aDescription.getControlCount() || CountSplitters(m_pMainArea) != aDescription.getSplitterCount())
+		return false;
+
+	for(size_t i = 0; i < aDescription.getControlCount(); ++i)
+	{
+		Description::ControlEntry const& aEntry = aDescription.getControl(i);
+		std::map<HWND, Control*>::const_iterator it = m_mapHwndControl.find(::GetDlgItem(m_hManagedWindow, aEntry.nId));
+		if(it == m_mapHwndControl.end() || it->second->isVirtual())
+			return false;
+
+		Align::Slot aHorz(DescribedAlignment(aEntry.nHorz, aEntry.nHorzMin));
+		Align::Slot aVert(DescribedAlignment(aEntry.nVert, aEntry.nVertMin));
+		Align::Slot const& aCtrlHorz = it->second->getHorzSlot();
+		Align::Slot const& aCtrlVert = it->second->getVertSlot();
+		if(aCtrlHorz.nKind != aHorz.nKind || aCtrlHorz.iParam != aHorz.iParam || aCtrlVert.nKind != aVert.nKind || aCtrlVert.iParam != aVert.iParam)
+			return false;
+	}
+	return true;
+}
+
 void Manager::updateAllOrigRect() const
 {
+	if(m_nTransactionDepth > 0)
+	{
+		m_bOrigRectsPending = true;
+		return;
+	}
+
+	LAYOUT_TRACE_SCOPE("Manager::updateAllOrigRect");
+	LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseInvalidate);
 	m_pMainArea->updateOrigRect();
 }
 
+void Manager::beginTransaction()
+{
+	if(m_nTransactionDepth++ > 0)
+		return;
+
+	// A hidden window must not be turned visible by WM_SETREDRAW at commit()
+	m_bRedrawSuspended = ::IsWindowVisible(m_hManagedWindow) != FALSE;
+	if(m_bRedrawSuspended)
+		::SendMessage(m_hManagedWindow, WM_SETREDRAW, FALSE, 0);
+}
+
+void Manager::commit()
+{
+	ASSERT(m_nTransactionDepth > 0);
+	if(m_nTransactionDepth == 0 || --m_nTransactionDepth > 0)
+		return;
+
+	LAYOUT_TRACE_SCOPE("Manager::commit");
+	if(m_bOrigRectsPending)
+	{
+		m_bOrigRectsPending = false;
+		updateAllOrigRect();
+	}
+
+	// A control may have been shown and hidden again, applyVisibility() skips those
+	std::sort(m_vTransactionControls.begin(), m_vTransactionControls.end());
+	m_vTransactionControls.erase(std::unique(m_vTransactionControls.begin(), m_vTransactionControls.end()), m_vTransactionControls.end());
+	std::vector<Control*> vControls;
+	vControls.swap(m_vTransactionControls);
+	applyVisibility(vControls);
+
+	update(true);
+
+	if(m_bRedrawSuspended)
+	{
+		m_bRedrawSuspended = false;
+		::SendMessage(m_hManagedWindow, WM_SETREDRAW, TRUE, 0);
+		::RedrawWindow(m_hManagedWindow, NULL, NULL, RDW_ERASE|RDW_FRAME|RDW_INVALIDATE|RDW_ALLCHILDREN);
+	}
+}
+
+void Manager::applyVisibility( std::vector<Control*> const& vControls )
+{
+	if(vControls.empty())
+		return;
+
+	HDWP windowPosHandle = BeginDeferWindowPos(vControls.size());
+	for each(Control* pControl in vControls)
+		if (!(windowPosHandle = pControl->applyVisibility(windowPosHandle)))
+			break;
+	if (windowPosHandle)
+	{
+		LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseApply);
+		EndDeferWindowPos(windowPosHandle);
+	}
+
+	// Virtual controls get or lose their window instead
+	if (!m_vVirtualControls.empty())
+	{
+		CRect rctVisible;
+		getViewportRect(rctVisible);
+		for each(Control* pControl in vControls)
+			if (pControl->isVirtual())
+				updateVirtualControl(pControl, rctVisible);
+	}
+}
+
+LayoutStats const& Manager::getLayoutStats() const
+{
+	return m_pPhaseClock->getStats();
+}
+
+void Manager::setLayoutCacheSize( UINT nEntries )
+{
+	delete m_pLayoutCache;
+	m_pLayoutCache = nEntries ? new LayoutCache(nEntries) : NULL;
+}
+
+void Manager::invalidateLayoutCache() const
+{
+	if(m_pLayoutCache)
+		m_pLayoutCache->clear();
+}
+
+void Manager::updateFromLayoutCache( CRect const& rctWindow )
+{
+	LayoutCache::Key aKey;
+	aKey.rctRoot = rctWindow;
+	getWnd()->ScreenToClient(aKey.rctRoot);
+	aKey.rctWindowClient = m_rctWindowClient;
+	getLayoutKey(m_pMainArea, aKey);
+
+	LayoutCache::Result const* pResult = m_pLayoutCache->find(aKey);
+	if(pResult)
+	{
+		LAYOUT_TRACE_SCOPE("Manager::updateFromLayoutCache");
+		CRect rctVisible;
+		getViewportRect(rctVisible);
+
+		size_t nArea = 0, nSplitter = 0, nControl = 0;
+		HDWP windowPosHandle = BeginDeferWindowPos(pResult->vControls.size());
+		windowPosHandle = applyLayoutResult(m_pMainArea, *pResult, nArea, nSplitter, nControl, windowPosHandle, rctVisible);
+		if(windowPosHandle)
+		{
+			LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseApply);
+			EndDeferWindowPos(windowPosHandle);
+		}
+
+		for each(Control* pCtrl in m_vVirtualControls)
+			if(pCtrl->getArea())
+				updateVirtualControl(pCtrl, rctVisible);
+
+		// The areas and splitters have no windows, the background is repainted as a whole
+		LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseInvalidate);
+		::InvalidateRect(m_hManagedWindow, NULL, TRUE);
+		m_aPassCounters.nMemoized = 1;
+		return;
+	}
+
+	unsigned int nGeneration = m_pLayoutCache->getGeneration();
+	m_pMainArea->update(rctWindow);
+
+	// A pass which rebased the orig rects or folded an area depends on more than its key
+	LayoutCache::Key aAfter;
+	getLayoutKey(m_pMainArea, aAfter);
+	if(m_pLayoutCache->getGeneration() != nGeneration || aAfter.vnFolded != aKey.vnFolded)
+		return;
+
+	LayoutCache::Result aResult;
+	getLayoutResult(m_pMainArea, aResult);
+	m_pLayoutCache->store(aKey, aResult);
+}
+
+void Manager::prepareMinSizes()
+{
+	std::vector<int> vFingerprint;
+	if(m_sLayoutIdentifier.empty() || !getMinSizeFingerprint(m_pMainArea, vFingerprint))
+		return;
+
+	if(!m_pTemplate || !m_pTemplate->matches(vFingerprint))
+		m_pTemplate = LayoutTemplate::find(m_sLayoutIdentifier);
+
+	if(m_pTemplate && m_pTemplate->matches(vFingerprint))
+	{
+		size_t nIndex = 0;
+		seedMinSizes(m_pMainArea, m_pTemplate->getMinSizes(), nIndex);
+		return;
+	}
+
+	// The first instance, or the dialog differs from the published one, e.g. after a font change
+	m_pMainArea->updateMinSize();
+	std::vector<SIZE> vMinSizes;
+	getMinSizes(m_pMainArea, vMinSizes);
+
+	Description aDescription;
+	std::string sText;
+	if(m_pTemplate)
+	{
+		aDescription = m_pTemplate->getDescription();
+		sText = m_pTemplate->getText();
+	}
+	m_pTemplate.reset(new LayoutTemplate(aDescription, vFingerprint, vMinSizes, sText));
+	LayoutTemplate::publish(m_sLayoutIdentifier, m_pTemplate);
+}
+
+bool Manager::getMinSizeFingerprint( Area const* pArea, std::vector<int>& vFingerprint ) const
+{
+	CRect const& rctOrig = pArea->m_rctOrigClientShape;
+	int aiArea[] = {rctOrig.Width(), rctOrig.Height(), pArea->m_hMinSize.cx, pArea->m_hMinSize.cy, pArea->m_hMaxSize.cx, pArea->m_hMaxSize.cy, (int) pArea->m_vControls.size()};
+	vFingerprint.insert(vFingerprint.end(), aiArea, aiArea + _countof(aiArea));
+	pArea->m_aTracks[Align::Horizontal].appendFingerprint(vFingerprint);
+	pArea->m_aTracks[Align::Vertical].appendFingerprint(vFingerprint);
+
+	// Control rects relative to the area, the min size does not depend on where the area is
+	for each(Control const* pCtrl in pArea->m_vControls)
+	{
+		if(pCtrl->m_aHorzAlign.nKind == Align::KindCustom || pCtrl->m_aVertAlign.nKind == Align::KindCustom)
+			return false;
+
+		CRect const& rctCtrl = pCtrl->m_rctOrig;
+		int aiCtrl[] = {rctCtrl.left - rctOrig.left, rctCtrl.top - rctOrig.top, rctCtrl.Width(), rctCtrl.Height(),
+			pCtrl->m_aHorzAlign.nKind, pCtrl->m_aHorzAlign.iParam, pCtrl->m_aVertAlign.nKind, pCtrl->m_aVertAlign.iParam, pCtrl->isShown()};
+		vFingerprint.insert(vFingerprint.end(), aiCtrl, aiCtrl + _countof(aiCtrl));
+	}
+
+	if(!pArea->isParentArea())
+	{
+		vFingerprint.push_back(-1);
+		return true;
+	}
+
+	vFingerprint.push_back(pArea->getSplitOrientation());
+	vFingerprint.push_back((int) pArea->m_vChildren.size());
+	for each(Area const* pChild in pArea->m_vChildren)
+	{
+		if(!getMinSizeFingerprint(pChild, vFingerprint))
+			return false;
+	}
+	return true;
+}
+
+void Manager::getMinSizes( Area const* pArea, std::vector<SIZE>& vMinSizes ) const
+{
+	vMinSizes.push_back(pArea->m_hProcessedMinSize);
+	for each(Area const* pChild in pArea->m_vChildren)
+		getMinSizes(pChild, vMinSizes);
+}
+
+void Manager::seedMinSizes( Area const* pArea, std::vector<SIZE> const& vMinSizes, size_t& nIndex ) const
+{
+	pArea->m_hProcessedMinSize = vMinSizes[nIndex++];
+	pArea->m_bMinSizeStale = false;
+	for each(Area const* pChild in pArea->m_vChildren)
+		seedMinSizes(pChild, vMinSizes, nIndex);
+}
+
+void Manager::getLayoutKey( Area const* pArea, LayoutCache::Key& aKey ) const
+{
+	BYTE nFolded = 0;
+	if(pArea->isFolded(Splitter::Horizontal))
+		nFolded |= 1 << Splitter::Horizontal;
+	if(pArea->isFolded(Splitter::Vertical))
+		nFolded |= 1 << Splitter::Vertical;
+	aKey.vnFolded.push_back(nFolded);
+
+	for each(Splitter const* pSplitter in pArea->m_vSplitters)
+		aKey.vSplitters.push_back(pSplitter->m_rctCurrent);
+	for each(Area const* pChild in pArea->m_vChildren)
+		getLayoutKey(pChild, aKey);
+}
+
+void Manager::getLayoutResult( Area const* pArea, LayoutCache::Result& aResult ) const
+{
+	aResult.vAreas.push_back(pArea->m_rctCurrentClientShape);
+	for each(Control const* pCtrl in pArea->m_vControls)
+		aResult.vControls.push_back(pCtrl->m_rctCurrent);
+
+	for each(Splitter const* pSplitter in pArea->m_vSplitters)
+		aResult.vSplitters.push_back(pSplitter->m_rctCurrent);
+	for each(Area const* pChild in pArea->m_vChildren)
+		getLayoutResult(pChild, aResult);
+}
+
+HDWP Manager::applyLayoutResult( Area* pArea, LayoutCache::Result const& aResult, size_t& nArea, size_t& nSplitter, size_t& nControl, HDWP windowPosHandle, CRect const& rctVisible )
+{
+	pArea->setCurrentRect(aResult.vAreas[nArea++], false);
+
+	// The track edges follow the area rect, they are not part of the result
+	pArea->layoutTracks();
+	for each(Control* pCtrl in pArea->m_vControls)
+	{
+		pCtrl->m_rctCurrent = aResult.vControls[nControl++];
+		m_pHitTestIndex->update(HitTestIndex::Element(HitTestIndex::KindControl, pCtrl), pCtrl->m_rctCurrent);
+	}
+
+	if(windowPosHandle)
+		windowPosHandle = pArea->applyControls(windowPosHandle, rctVisible);
+
+	for each(Splitter* pSplitter in pArea->m_vSplitters)
+	{
+		pSplitter->m_rctCurrent = pSplitter->m_rctApplied = aResult.vSplitters[nSplitter++];
+		pSplitter->updateHitTestEntry();
+	}
+
+	for each(Area* pChild in pArea->m_vChildren)
+		windowPosHandle = applyLayoutResult(pChild, aResult, nArea, nSplitter, nControl, windowPosHandle, rctVisible);
+	return windowPosHandle;
+}
+
 /***************************************************************
                Managed Layout Hook Infrastructure
  **************************************************************/
@@ -320,6 +1196,22 @@ LRESULT CALLBACK Manager::ManagedLayoutWindowProc( _In_ HWND hwnd, _In_ UINT uMs
 	if(pManager == NULL)
 		return lResult;
 
+	// Record the message before any processing changes its parameters
+	if(pManager->m_pMessageRecorder)
+	{
+		if(uMsg == WM_SIZING)
+		{
+			LPRECT lpRect = (LPRECT) lParam;
+			pManager->m_pMessageRecorder->record(MessageTrace::EventSizing, (UINT) wParam, lpRect->left, lpRect->top, lpRect->right, lpRect->bottom);
+		}
+		else if(uMsg == WM_SIZE)
+			pManager->m_pMessageRecorder->record(MessageTrace::EventSize, (UINT) wParam, LOWORD(lParam), HIWORD(lParam));
+	}
+
+	// Splitters have no window, their mouse messages arrive here
+	if(pManager->routeSplitterMessage(uMsg, wParam, lParam))
+		return uMsg == WM_SETCURSOR ? TRUE : 0;
+
 	// Execute the super window procedure
 	lResult = (pManager->getSuperWndProc())(hwnd, uMsg, wParam, lParam);
 
@@ -338,9 +1230,15 @@ LRESULT CALLBACK Manager::ManagedLayoutWindowProc( _In_ HWND hwnd, _In_ UINT uMs
 			lResult = FALSE;
 			break;
 		}
+		case WM_GETMINMAXINFO:
+		{
+			pManager->getMinMaxInfo((MINMAXINFO*) lParam);
+			lResult = 0;
+			break;
+		}
 		case WM_SIZING:
 		{
-			pManager->clampRect((UINT)wParam, (LPRECT)lParam);
+			// The system has clamped the rect to the track sizes of WM_GETMINMAXINFO already
 			lResult = TRUE;
 		}
 		case WM_MOVE:
@@ -355,6 +1253,18 @@ LRESULT CALLBACK Manager::ManagedLayoutWindowProc( _In_ HWND hwnd, _In_ UINT uMs
 			pManager->draw(hDC);
 			break;
 		}
+		case WM_MOUSEMOVE:
+		{
+			POINT ptClient = {(short) LOWORD(lParam), (short) HIWORD(lParam)};
+			pManager->updateHoveredArea(false, ptClient);
+			break;
+		}
+		case WM_MOUSELEAVE:
+		{
+			POINT ptClient = {0, 0};
+			pManager->updateHoveredArea(true, ptClient);
+			break;
+		}
 		case WNDMSG_LAYOUT_MODALPAGECLOSED:
 		{
 			if(pManager->getModalPage() != NULL)
@@ -447,6 +1357,7 @@ void Manager::storeSizeAndPosition()
 {
 	if( !m_sProfilingPath.empty() && ::IsWindowVisible(m_hManagedWindow) )
 	{
+		LAYOUT_TRACE_SCOPE_DETAIL("Profile::write", m_sProfilingPath.c_str(), -1);
 		BOOL bIconic, bMaximized;
 		WINDOWPLACEMENT wndpl;
 
@@ -487,6 +1398,8 @@ void Manager::restoreFromProfile()
 	if(m_sProfilingPath.empty() || m_nProfilingMode == ProfileOff)
 		return;
 
+	LAYOUT_TRACE_SCOPE_DETAIL("Profile::read", m_sProfilingPath.c_str(), -1);
+
 	bool success(true);
 	CRect rctRestore;
 	long width = 0, heigth = 0, iconic = 0, maximized = 0;
@@ -585,7 +1498,136 @@ CRect GetDisplayBounds()
 
 void Layout::Manager::draw( HDC hDC )
 {
-	m_pMainArea->draw(hDC);
+	{
+		LAYOUT_TIME_PHASE(m_pPhaseClock, PhaseDraw);
+
+		// The areas draw in layout coords
+		POINT ptOldOrigin;
+		::OffsetViewportOrgEx(hDC, -m_ptViewportOrigin.x, -m_ptViewportOrigin.y, &ptOldOrigin);
+		m_pMainArea->draw(hDC);
+		::SetViewportOrgEx(hDC, ptOldOrigin.x, ptOldOrigin.y, NULL);
+	}
+	LAYOUT_END_PASS(m_pPhaseClock);
+}
+
+bool Layout::Manager::routeSplitterMessage( UINT uMsg, WPARAM wParam, LPARAM lParam )
+{
+	CPoint ptClient((short) LOWORD(lParam), (short) HIWORD(lParam));
+	switch(uMsg)
+	{
+		case WM_SETCURSOR:
+		{
+			if((HWND) wParam != m_hManagedWindow || LOWORD(lParam) != HTCLIENT)
+				return false;
+
+			::GetCursorPos(&ptClient);
+			::ScreenToClient(m_hManagedWindow, &ptClient);
+			Splitter* pSplitter = splitterAt(ptClient + m_ptViewportOrigin);
+			if(pSplitter == NULL)
+				return false;
+
+			pSplitter->OnSetCursor();
+			return true;
+		}
+		case WM_LBUTTONDOWN:
+		{
+			Splitter* pSplitter = splitterAt(ptClient + m_ptViewportOrigin);
+			if(pSplitter == NULL)
+				return false;
+
+			m_pCapturedSplitter = pSplitter;
+			pSplitter->OnLButtonDown((UINT) wParam, ptClient);
+			return true;
+		}
+		case WM_MOUSEMOVE:
+		{
+			if(m_pCapturedSplitter == NULL)
+				return false;
+
+			m_pCapturedSplitter->OnMouseMove((UINT) wParam, ptClient);
+			return true;
+		}
+		case WM_LBUTTONUP:
+		case WM_CAPTURECHANGED:
+		{
+			if(m_pCapturedSplitter == NULL || (uMsg == WM_CAPTURECHANGED && (HWND) lParam == m_hManagedWindow))
+				return false;
+
+			// A lost capture ends the drag where the cursor is
+			if(uMsg == WM_CAPTURECHANGED)
+			{
+				::GetCursorPos(&ptClient);
+				::ScreenToClient(m_hManagedWindow, &ptClient);
+			}
+
+			// Reset first, the splitter releases the capture, which sends WM_CAPTURECHANGED
+			Splitter* pSplitter = m_pCapturedSplitter;
+			m_pCapturedSplitter = NULL;
+			pSplitter->OnLButtonUp((UINT) wParam, ptClient);
+			return true;
+		}
+		case WM_TIMER:
+		{
+			if(wParam != Splitter::DragTimerId || m_pCapturedSplitter == NULL)
+				return false;
+
+			m_pCapturedSplitter->OnTimer();
+			return true;
+		}
+	}
+	return false;
+}
+
+void Layout::Manager::hitTest( POINT ptLayout, __out std::vector<HitTestIndex::Element>& vResult ) const
+{
+	m_pHitTestIndex->queryPoint(ptLayout, vResult);
+}
+
+void Layout::Manager::hitTest( CRect const& rctLayout, __out std::vector<HitTestIndex::Element>& vResult ) const
+{
+	m_pHitTestIndex->queryIntersecting(rctLayout, vResult);
+}
+
+Area* Layout::Manager::areaAt( POINT ptLayout ) const
+{
+	std::vector<HitTestIndex::Element> vElements;
+	m_pHitTestIndex->queryPoint(ptLayout, vElements);
+
+	// The leaf areas do not overlap. Null, if the point is on a splitter or covered by the window menu.
+	for each(HitTestIndex::Element const& aElement in vElements)
+		if(aElement.nKind == HitTestIndex::KindArea && aElement.pArea->m_bVisible && aElement.pArea->m_rctCurrentVisibleClientShape.PtInRect(ptLayout))
+			return aElement.pArea;
+	return NULL;
+}
+
+Splitter* Layout::Manager::splitterAt( POINT ptLayout ) const
+{
+	std::vector<HitTestIndex::Element> vElements;
+	m_pHitTestIndex->queryPoint(ptLayout, vElements);
+
+	for each(HitTestIndex::Element const& aElement in vElements)
+		if(aElement.nKind == HitTestIndex::KindSplitter && aElement.getSplitter()->isVisible())
+			return aElement.getSplitter();
+	return NULL;
+}
+
+void Layout::Manager::updateHoveredArea( bool bMouseLeft, POINT ptClient )
+{
+	// The area decides itself whether the mouse really left, it may only be above one of its controls
+	if(bMouseLeft)
+	{
+		if(m_pHoveredArea != NULL)
+			const_cast<Area*>(m_pHoveredArea)->OnMouseLeave();
+		return;
+	}
+
+	ptClient.x += m_ptViewportOrigin.x;
+	ptClient.y += m_ptViewportOrigin.y;
+	Area* pArea = areaAt(ptClient);
+	if(pArea != NULL && pArea->hasStyle(AreaStyleHover))
+		pArea->setHovered();
+	else
+		setHoveredArea(NULL);
 }
 
 Control const* Layout::Manager::getControl(HWND hCtrl)
@@ -601,6 +1643,13 @@ void Layout::Manager::initMgr( HWND hParent, const SIZE& hMaxSize, const SIZE& h
 {
 	AFXASSUME(hParent);
 	m_hManagedWindow = hParent;
+	::GetClientRect(hParent, &m_rctWindowClient);
+
+	// Unrelated managers without identifier would all add up in one entry of the dump
+	if(m_sLayoutIdentifier.empty())
+		m_pOwnStats = new LayoutStats(m_sLayoutIdentifier);
+	m_pPhaseClock = new PhaseClock(m_pOwnStats ? m_pOwnStats : LayoutStats::forIdentifier(m_sLayoutIdentifier));
+	m_pHitTestIndex = new HitTestIndex();
 
 	CRect hRect;
 	::GetWindowRect(hParent, &hRect);
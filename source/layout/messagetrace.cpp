@@ -0,0 +1,115 @@
+// This file does not use the precompiled header on purpose:
+// Traces must be readable without any MFC/Win32 dependency.
+
+#include "../../GlobExport/messagetrace.h"
+
+#include <cstring>
+
+using namespace Layout;
+
+namespace
+{
+const char TRACE_MAGIC[4] = {'D', 'L', 'M', 'T'};
+// v2: Splitter events are addressed by cursor position instead of splitter control id
+// v3: The frame of the managed window, the replay window may have another one
+const boost::uint32_t TRACE_VERSION = 3;
+
+struct TraceHeader
+{
+	char achMagic[4];
+	boost::uint32_t nVersion;
+	boost::int32_t iWidth;
+	boost::int32_t iHeight;
+	boost::int32_t aiFrame[4];
+	boost::uint32_t nControls;
+	boost::uint32_t nEvents;
+	boost::uint32_t nDescriptionBytes;
+};
+
+template<class TEntry>
+void AppendTable(std::vector<TEntry> const& vTable, std::vector<char>& vResult)
+{
+	if (vTable.empty())
+		return;
+	char const* pchBegin = reinterpret_cast<char const*>(&vTable[0]);
+	vResult.insert(vResult.end(), pchBegin, pchBegin + vTable.size() * sizeof(TEntry));
+}
+
+template<class TEntry>
+void ReadTable(char const*& pchCursor, size_t nCount, std::vector<TEntry>& vTable)
+{
+	vTable.resize(nCount);
+	if (nCount)
+		memcpy(&vTable[0], pchCursor, nCount * sizeof(TEntry));
+	pchCursor += nCount * sizeof(TEntry);
+}
+}
+
+MessageTrace::MessageTrace() :
+	m_iWidth(0),
+	m_iHeight(0)
+{
+	memset(m_aiFrame, 0, sizeof(m_aiFrame));
+}
+
+void MessageTrace::clear()
+{
+	m_iWidth = m_iHeight = 0;
+	memset(m_aiFrame, 0, sizeof(m_aiFrame));
+	m_vControls.clear();
+	m_vEvents.clear();
+	m_vDescription.clear();
+}
+
+void MessageTrace::toBinary( std::vector<char>& vResult ) const
+{
+	TraceHeader aHeader;
+	memcpy(aHeader.achMagic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	aHeader.nVersion = TRACE_VERSION;
+	aHeader.iWidth = m_iWidth;
+	aHeader.iHeight = m_iHeight;
+	memcpy(aHeader.aiFrame, m_aiFrame, sizeof(aHeader.aiFrame));
+	aHeader.nControls = (boost::uint32_t) m_vControls.size();
+	aHeader.nEvents = (boost::uint32_t) m_vEvents.size();
+	aHeader.nDescriptionBytes = (boost::uint32_t) m_vDescription.size();
+
+	char const* pchHeader = reinterpret_cast<char const*>(&aHeader);
+	vResult.assign(pchHeader, pchHeader + sizeof(aHeader));
+	AppendTable(m_vControls, vResult);
+	AppendTable(m_vEvents, vResult);
+	AppendTable(m_vDescription, vResult);
+}
+
+bool MessageTrace::loadBinary( void const* pData, size_t nSize )
+{
+	clear();
+
+	char const* pchData = static_cast<char const*>(pData);
+	if (pchData == NULL || nSize < sizeof(TraceHeader))
+		return false;
+
+	TraceHeader aHeader;
+	memcpy(&aHeader, pchData, sizeof(aHeader));
+	if (memcmp(aHeader.achMagic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || aHeader.nVersion != TRACE_VERSION)
+		return false;
+
+	// Guards the size calculation below against overflowing counts
+	if (aHeader.nControls > nSize / sizeof(ControlEntry) || aHeader.nEvents > nSize / sizeof(Event) || aHeader.nDescriptionBytes > nSize)
+		return false;
+
+	size_t nExpected = sizeof(aHeader)
+		+ aHeader.nControls * sizeof(ControlEntry)
+		+ aHeader.nEvents * sizeof(Event)
+		+ aHeader.nDescriptionBytes;
+	if (nSize < nExpected)
+		return false;
+
+	char const* pchCursor = pchData + sizeof(aHeader);
+	ReadTable(pchCursor, aHeader.nControls, m_vControls);
+	ReadTable(pchCursor, aHeader.nEvents, m_vEvents);
+	ReadTable(pchCursor, aHeader.nDescriptionBytes, m_vDescription);
+	m_iWidth = aHeader.iWidth;
+	m_iHeight = aHeader.iHeight;
+	memcpy(m_aiFrame, aHeader.aiFrame, sizeof(m_aiFrame));
+	return true;
+}
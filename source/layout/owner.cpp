@@ -61,6 +61,24 @@ bool Owner::setLayout(HWND hCtrl, std::string sID, Align::Mode& hHorzAlignment,
 		return false;
 }
 
+bool Owner::setLayout(UINT nID, std::string sID, Align::Slot const& aHorzAlignment, Align::Slot const& aVertAlignment)
+{
+	VERIFY_ALIGNENDDLG_INITIALIZING()
+	if( m_pManager )
+		return m_pManager->addControl(nID, aHorzAlignment, aVertAlignment, sID);
+	else
+		return false;
+}
+
+bool Owner::setLayout(HWND hCtrl, std::string sID, Align::Slot const& aHorzAlignment, Align::Slot const& aVertAlignment)
+{
+	VERIFY_ALIGNENDDLG_INITIALIZING()
+	if( m_pManager )
+		return m_pManager->addControl(hCtrl, aHorzAlignment, aVertAlignment, sID);
+	else
+		return false;
+}
+
 bool Owner::setLayout(UINT nID, Align::Mode& hHorzAlignment, Align::Mode& hVertAlignment)
 {
 	return setLayout(nID, "", hHorzAlignment, hVertAlignment);
@@ -76,10 +94,11 @@ bool Layout::Owner::layoutAll(HWND hParent, Align::Mode& hHorzAlignment, Align::
 	VERIFY_ALIGNENDDLG_INITIALIZING()
 	if( m_pManager )
 	{
-		bool result(true);
-		for (HWND wnd = ::GetWindow(hParent, GW_CHILD); result && wnd != NULL; wnd = ::GetNextWindow(wnd, GW_HWNDNEXT))
-			result |= m_pManager->addControl(wnd, hHorzAlignment, hVertAlignment, "");
-		return result;
+		std::vector<Manager::ControlSpec> vSpecs;
+		for (HWND wnd = ::GetWindow(hParent, GW_CHILD); wnd != NULL; wnd = ::GetNextWindow(wnd, GW_HWNDNEXT))
+			vSpecs.push_back(Manager::ControlSpec(wnd, hHorzAlignment.getSlot(), hVertAlignment.getSlot()));
+		m_pManager->addControls(vSpecs);
+		return true;
 	}
 	else
 		return false;
@@ -112,6 +131,21 @@ Splitter const* Owner::putSplitter(AreaProperties& aHighAreaParams, AreaProperti
 		return NULL;
 }
 
+bool Owner::applyDescription(Description const& aDescription)
+{
+	VERIFY_ALIGNENDDLG_INITIALIZING()
+	if(m_pManager)
+		return m_pManager->applyDescription(aDescription);
+	else
+		return false;
+}
+
+bool Owner::applyDescription(char const* pchText, std::string* psError /*= NULL*/)
+{
+	LayoutTemplate::Ptr pTemplate = LayoutTemplate::forDescription(m_sLayoutName, pchText, psError);
+	return pTemplate && applyDescription(pTemplate->getDescription());
+}
+
 #undef VERIFY_ALIGNENDDLG_INITIALIZING
 
 void Owner::setManager(Manager* pAlignmentManager)
@@ -0,0 +1,250 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/replay.h"
+#include "../../GlobExport/manager.h"
+#include "../../GlobExport/description.h"
+
+#include <set>
+
+using namespace Layout;
+
+namespace
+{
+const char REPLAY_WINDOW_CLASS[] = "DynLayoutReplay";
+const DWORD REPLAY_WINDOW_STYLE = WS_OVERLAPPEDWINDOW;
+
+void RegisterReplayClass()
+{
+	WNDCLASS aClass;
+	if(::GetClassInfo(AfxGetInstanceHandle(), REPLAY_WINDOW_CLASS, &aClass))
+		return;
+
+	memset(&aClass, 0, sizeof(aClass));
+	aClass.lpfnWndProc = ::DefWindowProc;
+	aClass.hInstance = AfxGetInstanceHandle();
+	aClass.lpszClassName = REPLAY_WINDOW_CLASS;
+	::RegisterClass(&aClass);
+}
+
+/** Resizes the window, so that its client rect gets the given size. */
+void SetClientSize(HWND hWnd, int iWidth, int iHeight)
+{
+	RECT rctWindow = {0, 0, iWidth, iHeight};
+	::AdjustWindowRectEx(&rctWindow, REPLAY_WINDOW_STYLE, FALSE, 0);
+	::SetWindowPos(hWnd, NULL, 0, 0, rctWindow.right - rctWindow.left, rctWindow.bottom - rctWindow.top, SWP_NOMOVE|SWP_NOZORDER|SWP_NOACTIVATE);
+}
+
+/** Delivers the width of the non-client frame of the window on each side, see MessageTrace::setFrame(). */
+void GetFrame(HWND hWnd, int aiFrame[4])
+{
+	RECT rctWindow, rctClient;
+	::GetWindowRect(hWnd, &rctWindow);
+	::GetClientRect(hWnd, &rctClient);
+	::MapWindowPoints(hWnd, NULL, (LPPOINT) &rctClient, 2);
+	aiFrame[0] = rctClient.left - rctWindow.left;
+	aiFrame[1] = rctClient.top - rctWindow.top;
+	aiFrame[2] = rctWindow.right - rctClient.right;
+	aiFrame[3] = rctWindow.bottom - rctClient.bottom;
+}
+
+/** Returns whether two controls of the table share a dialog item id, e.g. IDC_STATIC. They could not be told apart by the description. */
+bool HasDuplicateIds(MessageTrace const& aTrace)
+{
+	std::set<boost::uint32_t> setIds;
+	for(size_t nIndex = 0; nIndex < aTrace.getControlCount(); ++nIndex)
+		if(!setIds.insert(aTrace.getControl(nIndex).nId).second)
+			return true;
+	return false;
+}
+
+/**
+ * Sends a recorded event to the replay window.
+ * @param aiFrameGrowth How much wider the frame of the replay window is on each side than the recorded one.
+ */
+void DispatchEvent(HWND hWnd, MessageTrace::Event const& aEvent, int const aiFrameGrowth[4])
+{
+	switch(aEvent.nKind)
+	{
+		case MessageTrace::EventSizing:
+		{
+			// Like the sizing loop of the system: WM_SIZING, then the window is resized to the rect, which
+			// runs the layout pass. The recorded rect is already clamped to the track sizes.
+			// It keeps its client rect within the frame of the replay window.
+			RECT rctProposed = {
+				aEvent.aiValue[0] - aiFrameGrowth[0], aEvent.aiValue[1] - aiFrameGrowth[1],
+				aEvent.aiValue[2] + aiFrameGrowth[2], aEvent.aiValue[3] + aiFrameGrowth[3]
+			};
+			::SendMessage(hWnd, WM_SIZING, aEvent.nParam, (LPARAM) &rctProposed);
+			::SetWindowPos(hWnd, NULL, 0, 0, rctProposed.right - rctProposed.left, rctProposed.bottom - rctProposed.top, SWP_NOMOVE|SWP_NOZORDER|SWP_NOACTIVATE);
+			break;
+		}
+		case MessageTrace::EventSize:
+		{
+			// The manager reads the window rect, so the window is really resized instead of sending WM_SIZE
+			SetClientSize(hWnd, aEvent.aiValue[0], aEvent.aiValue[1]);
+			break;
+		}
+		case MessageTrace::EventSplitterDown:
+		case MessageTrace::EventSplitterMove:
+		case MessageTrace::EventSplitterUp:
+		{
+			// The manager routes the messages to the splitter below the cursor
+			UINT nMessage = WM_MOUSEMOVE;
+			if(aEvent.nKind == MessageTrace::EventSplitterDown)
+				nMessage = WM_LBUTTONDOWN;
+			else if(aEvent.nKind == MessageTrace::EventSplitterUp)
+				nMessage = WM_LBUTTONUP;
+
+			::SendMessage(hWnd, nMessage, MK_LBUTTON, MAKELPARAM(aEvent.aiValue[1], aEvent.aiValue[2]));
+			break;
+		}
+	}
+}
+}
+
+/***************************************************************
+                          MessageRecorder
+ **************************************************************/
+
+MessageRecorder::MessageRecorder( Manager* pManager, Description const& aDescription ) :
+	m_pManager(pManager),
+	m_nStartTick(::GetTickCount()),
+	m_bRecording(false)
+{
+	// A trace of a layout the replay cannot rebuild would benchmark a different layout
+	if(!pManager->matchesDescription(aDescription))
+		return;
+
+	CRect rctClient;
+	::GetClientRect(pManager->m_hManagedWindow, &rctClient);
+	m_aTrace.setClientSize(rctClient.Width(), rctClient.Height());
+
+	int aiFrame[4];
+	GetFrame(pManager->m_hManagedWindow, aiFrame);
+	m_aTrace.setFrame(aiFrame[0], aiFrame[1], aiFrame[2], aiFrame[3]);
+
+	std::vector<char> vImage;
+	aDescription.toBinary(vImage);
+	m_aTrace.setDescription(vImage);
+
+	// Virtual controls have no dialog item id, they cannot be rebuilt by the replay
+	for each(std::pair<HWND, Control*> const& aPair in pManager->m_mapHwndControl)
+	{
+		if(aPair.second->isVirtual())
+			continue;
+
+		CRect const& rctControl = aPair.second->getRect();
+		MessageTrace::ControlEntry aEntry;
+		aEntry.nId = ::GetDlgCtrlID(aPair.first);
+		aEntry.aiRect[0] = rctControl.left;
+		aEntry.aiRect[1] = rctControl.top;
+		aEntry.aiRect[2] = rctControl.right;
+		aEntry.aiRect[3] = rctControl.bottom;
+		m_aTrace.addControl(aEntry);
+	}
+
+	if(HasDuplicateIds(m_aTrace))
+	{
+		m_aTrace.clear();
+		return;
+	}
+
+	pManager->m_pMessageRecorder = this;
+	m_bRecording = true;
+}
+
+MessageRecorder::~MessageRecorder()
+{
+	if(m_pManager->m_pMessageRecorder == this)
+		m_pManager->m_pMessageRecorder = NULL;
+}
+
+void MessageRecorder::record( MessageTrace::EventKind nKind, unsigned int nParam, int iValue0, int iValue1 /*= 0*/, int iValue2 /*= 0*/, int iValue3 /*= 0*/ )
+{
+	MessageTrace::Event aEvent;
+	aEvent.nTimeMs = ::GetTickCount() - m_nStartTick;
+	aEvent.nKind = (boost::uint16_t) nKind;
+	aEvent.nParam = (boost::uint16_t) nParam;
+	aEvent.aiValue[0] = iValue0;
+	aEvent.aiValue[1] = iValue1;
+	aEvent.aiValue[2] = iValue2;
+	aEvent.aiValue[3] = iValue3;
+	m_aTrace.addEvent(aEvent);
+}
+
+/***************************************************************
+                          MessageReplayer
+ **************************************************************/
+
+bool MessageReplayer::replay( MessageTrace const& aTrace, std::vector<double>& vLatencyUs, std::vector<MessageTrace::ControlEntry>* pvFinalControls /*= NULL*/ )
+{
+	vLatencyUs.clear();
+	if(pvFinalControls)
+		pvFinalControls->clear();
+
+	std::vector<char> const& vImage = aTrace.getDescription();
+	Description aDescription;
+	if(vImage.empty() || !aDescription.loadBinary(&vImage[0], vImage.size()) || HasDuplicateIds(aTrace))
+		return false;
+
+	RegisterReplayClass();
+	HWND hWnd = ::CreateWindowEx(0, REPLAY_WINDOW_CLASS, "", REPLAY_WINDOW_STYLE, 0, 0, 0, 0, NULL, NULL, AfxGetInstanceHandle(), NULL);
+	if(!hWnd)
+		return false;
+
+	SetClientSize(hWnd, aTrace.getClientWidth(), aTrace.getClientHeight());
+
+	int aiFrameGrowth[4];
+	GetFrame(hWnd, aiFrameGrowth);
+	for(size_t nSide = 0; nSide < 4; ++nSide)
+		aiFrameGrowth[nSide] -= aTrace.getFrame(nSide);
+
+	std::vector<HWND> vControls(aTrace.getControlCount());
+	for(size_t nIndex = 0; nIndex < aTrace.getControlCount(); ++nIndex)
+	{
+		MessageTrace::ControlEntry const& aEntry = aTrace.getControl(nIndex);
+		vControls[nIndex] = ::CreateWindowEx(0, "STATIC", "", WS_CHILD|WS_VISIBLE,
+			aEntry.aiRect[0], aEntry.aiRect[1], aEntry.aiRect[2] - aEntry.aiRect[0], aEntry.aiRect[3] - aEntry.aiRect[1],
+			hWnd, (HMENU) (UINT_PTR) aEntry.nId, AfxGetInstanceHandle(), NULL);
+	}
+
+	bool bResult = false;
+	{
+		Manager aManager(hWnd);
+		if(aManager.applyDescription(aDescription))
+		{
+			bResult = true;
+
+			LARGE_INTEGER nFrequency, nBegin, nEnd;
+			::QueryPerformanceFrequency(&nFrequency);
+			vLatencyUs.reserve(aTrace.getEventCount());
+
+			for(size_t nIndex = 0; nIndex < aTrace.getEventCount(); ++nIndex)
+			{
+				::QueryPerformanceCounter(&nBegin);
+				DispatchEvent(hWnd, aTrace.getEvent(nIndex), aiFrameGrowth);
+				::QueryPerformanceCounter(&nEnd);
+				vLatencyUs.push_back((double) (nEnd.QuadPart - nBegin.QuadPart) * 1000000.0 / (double) nFrequency.QuadPart);
+			}
+		}
+	}
+
+	// The windows keep the rects of the last pass after the manager is gone
+	for(size_t nIndex = 0; pvFinalControls && nIndex < vControls.size(); ++nIndex)
+	{
+		RECT rctControl;
+		::GetWindowRect(vControls[nIndex], &rctControl);
+		::MapWindowPoints(NULL, hWnd, (LPPOINT) &rctControl, 2);
+
+		MessageTrace::ControlEntry aEntry = aTrace.getControl(nIndex);
+		aEntry.aiRect[0] = rctControl.left;
+		aEntry.aiRect[1] = rctControl.top;
+		aEntry.aiRect[2] = rctControl.right;
+		aEntry.aiRect[3] = rctControl.bottom;
+		pvFinalControls->push_back(aEntry);
+	}
+
+	::DestroyWindow(hWnd);
+	return bResult;
+}
@@ -5,57 +5,49 @@
 #include "../../GlobExport/area.h"
 #include "../../GlobExport/manager.h"
 #include "../../GlobExport/gdiplusutil.h"
+#include "../../GlobExport/instrumentation.h"
+#include "../../GlobExport/trace.h"
+#include "../../GlobExport/replay.h"
 
 using namespace Layout;
 
-IMPLEMENT_DYNAMIC(Splitter, CStatic)
-
-BEGIN_MESSAGE_MAP(Splitter, CStatic)
-	ON_WM_SETCURSOR()
-	ON_WM_LBUTTONDOWN()
-	ON_WM_LBUTTONUP()
-	ON_WM_MOUSEMOVE()
-	ON_WM_ERASEBKGND()
-END_MESSAGE_MAP()
-
 Splitter* Splitter::Create( Area const* pArea, CRect rctSplitter, Orientation nOrientation, SplitterAlignment nAlignment )
 {
-	DWORD dwStyle = WS_CHILD|WS_VISIBLE|SS_NOTIFY|SS_OWNERDRAW;
-	
-	HWND hWndParent = pArea->getManager()->getWnd()->GetSafeHwnd();
-	UINT iSplitterId = pArea->getManager()->getNewControlID();
-	
-	HWND hWnd = ::CreateWindow(
-		"STATIC",
-		"",
-		dwStyle,
-		rctSplitter.left,
-		rctSplitter.top,
-		rctSplitter.Width(),
-		rctSplitter.Height(),
-		hWndParent,
-		(HMENU) iSplitterId,
-		AfxGetApp()->m_hInstance,
-		NULL
-	);
-		
-	Splitter* pResult = new Splitter(pArea, hWnd, nOrientation, nAlignment);
-	pResult->SubclassWindow(hWnd);
-	
+	Splitter* pResult = new Splitter(pArea, rctSplitter, nOrientation, nAlignment);
+	pResult->invalidate(rctSplitter);
+	pResult->updateHitTestEntry();
 	return pResult;
 }
 
-Splitter::Splitter( Area const* pArea, HWND hWnd, Orientation nOrientation, SplitterAlignment nAlignment )
+/**
+ * The alignment of a splitter across its orientation. Along its orientation, a splitter always resizes.
+ */
+static Align::Slot SplitterSlot( Splitter::SplitterAlignment nAlignment )
+{
+	return nAlignment == Splitter::AlignHigh ? Align::Slot(Align::KindTopLeft) : (nAlignment == Splitter::AlignLow ? Align::Slot(Align::KindBottomRight) : Align::Slot(Align::KindRelative));
+}
+
+/**
+ * A splitter is a control without window: its rect is pure geometry, like the one of a virtual control.
+ */
+Splitter::Splitter( Area const* pArea, CRect const& rctSplitter, Orientation nOrientation, SplitterAlignment nAlignment )
 	: Control(
 		pArea->getManager(),
-		hWnd,
-		nOrientation == Horizontal ? (Align::Mode&) Align::Resize() : (nAlignment == AlignHigh ? (Align::Mode&) Align::TopLeft() : (nAlignment == AlignLow ? (Align::Mode&) Align::BottomRight() : (Align::Mode&) Align::Relative(false))),
-		nOrientation == Vertical   ? (Align::Mode&) Align::Resize() : (nAlignment == AlignHigh ? (Align::Mode&) Align::TopLeft() : (nAlignment == AlignLow ? (Align::Mode&) Align::BottomRight() : (Align::Mode&) Align::Relative(false)))
+		0,
+		rctSplitter,
+		nOrientation == Horizontal ? Align::Traits<Align::Resize>::slot() : SplitterSlot(nAlignment),
+		nOrientation == Vertical   ? Align::Traits<Align::Resize>::slot() : SplitterSlot(nAlignment)
 	),
 	m_nAlignment(nAlignment),
 	m_nOrientation(nOrientation),
+	m_nIndex(0),
 	m_bDragging(false),
-	m_hHandleColor(0)
+	m_hHandleColor(0),
+	m_ptDragTarget(0, 0),
+	m_bDragTargetSet(false),
+	m_nLastLayoutTick(0),
+	m_rctTracker(0, 0, 0, 0),
+	m_bTrackerShown(false)
 {
 	setAlignmentArea(pArea);
 	setHandleColor(RGBA(200, 200, 200, 255));
@@ -63,10 +55,14 @@ Splitter::Splitter( Area const* pArea, HWND hWnd, Orientation nOrientation, Spli
 
 Splitter::~Splitter()
 {
+	Manager const* pManager = getManager();
+	if(pManager && pManager->m_pHitTestIndex)
+		pManager->m_pHitTestIndex->remove(HitTestIndex::Element(HitTestIndex::KindSplitter, this));
 }
 
 bool Splitter::move( int iHorzPos, int iVertPos )
 {
+	LAYOUT_TRACE_SCOPE("Splitter::move");
 	CRect rctOrig(m_rctCurrent);
 
 	bool bResult = false;
@@ -80,58 +76,94 @@ bool Splitter::move( int iHorzPos, int iVertPos )
 		bResult = true;
 		m_rctCurrent.MoveToX(iHorzPos);
 	}
-	
+
 	if(bResult)
 	{
-		getArea()->checkSplitterRectWithChildAreaMinSizesAndAutoFold(m_rctCurrent);
+		getArea()->checkSplitterRectWithChildAreaMinSizesAndAutoFold(m_nIndex, m_rctCurrent);
 		if(rctOrig == m_rctCurrent)
 			bResult = false;
-			
+
 		if(bResult)
 		{
-			getControl()->MoveWindow(&m_rctCurrent);
-			updateOrigRect();
+			// The child areas cover the rest, their controls are invalidated when they move
+			invalidate(rctOrig);
+			invalidate(m_rctCurrent);
+			m_rctApplied = m_rctCurrent;
+			updateHitTestEntry();
 		}
 	}
 	return bResult;
 }
 
-afx_msg BOOL Splitter::OnSetCursor( CWnd* pWnd, UINT nHitTest, UINT message )
+void Splitter::OnSetCursor()
 {
 	// Set the right cursor
 	if(getOrientation() == Horizontal)
 		::SetCursor(AfxGetApp()->LoadStandardCursor(IDC_SIZENS));
 	else
 		::SetCursor(AfxGetApp()->LoadStandardCursor(IDC_SIZEWE));
-		
-	return TRUE;
 }
 
 void Splitter::OnMouseMove( UINT nFlags, CPoint point )
 {
 	if(m_bDragging)
 	{
-		this->ClientToScreen(&point);
-		this->GetParent()->ScreenToClient(&point);
-		if(move(point.x, point.y))
+		recordDrag(MessageTrace::EventSplitterMove, point);
+		point += getManager()->getViewportOrigin();
+		m_ptDragTarget = point;
+		m_bDragTargetSet = true;
+
+		switch(getManager()->getSplitterDragMode())
 		{
-			const_cast<Area*>(getArea())->updateChildAreas();
-			getArea()->getManager()->updateAllOrigRect();
+			case DragPreview:
+				showTracker(point);
+				break;
+
+			case DragThrottled:
+			{
+				DWORD nElapsed = ::GetTickCount() - m_nLastLayoutTick;
+				UINT nInterval = getManager()->getSplitterDragInterval();
+				if(nElapsed < nInterval)
+				{
+					// Restarting the timer is fine, it fires at most one interval after this move
+					::SetTimer(getManager()->getHwnd(), DragTimerId, nInterval - nElapsed, NULL);
+					break;
+				}
+				dragTo(point);
+				break;
+			}
+
+			default:
+				dragTo(point);
+				break;
 		}
 	}
 }
 
 void Splitter::OnLButtonDown( UINT nFlags, CPoint point )
 {
+	recordDrag(MessageTrace::EventSplitterDown, point);
 	m_bDragging = true;
-	SetCapture();
+	m_bDragTargetSet = false;
+	m_nLastLayoutTick = ::GetTickCount();
+	::SetCapture(getManager()->getHwnd());
 }
 
 void Splitter::OnLButtonUp( UINT nFlags, CPoint point )
 {
+	recordDrag(MessageTrace::EventSplitterUp, point);
+	::KillTimer(getManager()->getHwnd(), DragTimerId);
+	hideTracker();
+
+	// A preview or throttled drag has not reached the last position yet. The splitter
+	// is only moved, the child areas are laid out once below. For a live drag, the
+	// splitter already is there and nothing happens.
+	if(m_bDragging && m_bDragTargetSet && move(m_ptDragTarget.x, m_ptDragTarget.y))
+		const_cast<Area*>(getArea())->rebaseOrigRect();
+
 	m_bDragging = false;
-	ReleaseCapture();
-	
+	::ReleaseCapture();
+
 	// On Mouse Release, the User returns the control
 	// of the splitter to the layout engine. This is the
 	// moment, when the splitter has to ask its splitted
@@ -141,52 +173,138 @@ void Splitter::OnLButtonUp( UINT nFlags, CPoint point )
 	const_cast<Area*>(getArea())->updateChildAreas();
 }
 
+void Splitter::OnTimer()
+{
+	::KillTimer(getManager()->getHwnd(), DragTimerId);
+	if(m_bDragging && m_bDragTargetSet)
+		dragTo(m_ptDragTarget);
+}
+
+void Splitter::dragTo( CPoint ptLayout )
+{
+	m_nLastLayoutTick = ::GetTickCount();
+	if(!move(ptLayout.x, ptLayout.y))
+		return;
+
+	Area* pArea = const_cast<Area*>(getArea());
+	pArea->updateChildAreas();
+
+	// Only the shapes below the splitter's area changed
+	pArea->rebaseOrigRect();
+	LAYOUT_END_PASS(getManager()->m_pPhaseClock);
+}
+
+void Splitter::showTracker( CPoint ptLayout )
+{
+	// Where move() would put the splitter, without touching any window
+	CRect rctTracker(m_rctCurrent);
+	if(m_nOrientation == Horizontal)
+		rctTracker.MoveToY(ptLayout.y);
+	else
+		rctTracker.MoveToX(ptLayout.x);
+	getArea()->checkSplitterRectWithChildAreaMinSizesAndAutoFold(m_nIndex, rctTracker);
+	rctTracker.OffsetRect(-getManager()->getViewportOrigin());
+
+	if(m_bTrackerShown && rctTracker == m_rctTracker)
+		return;
+
+	hideTracker();
+	invertTracker(rctTracker);
+	m_rctTracker = rctTracker;
+	m_bTrackerShown = true;
+}
+
+void Splitter::hideTracker()
+{
+	if(!m_bTrackerShown)
+		return;
+
+	invertTracker(m_rctTracker);
+	m_bTrackerShown = false;
+}
+
+void Splitter::invertTracker( CRect const& rctTracker ) const
+{
+	// A cache DC without DCX_CLIPCHILDREN paints across the controls of the managed window
+	CWnd* pParent = getManager()->getWnd();
+	CDC* pDC = pParent->GetDCEx(NULL, DCX_CACHE|DCX_LOCKWINDOWUPDATE);
+	if(!pDC)
+		return;
+
+	CBrush* pOldBrush = pDC->SelectObject(CDC::GetHalftoneBrush());
+	pDC->PatBlt(rctTracker.left, rctTracker.top, rctTracker.Width(), rctTracker.Height(), PATINVERT);
+	if(pOldBrush)
+		pDC->SelectObject(pOldBrush);
+	pParent->ReleaseDC(pDC);
+}
+
 void Splitter::update()
 {
-	CRect rctOld(getRect());
-	
-	// update horizontal and vertical alignment
-	m_pHorzAlign->update(this, Align::Horizontal, m_rctCurrent);
-	m_pVertAlign->update(this, Align::Vertical, m_rctCurrent); 
-	
+	alignRect();
+
 	// incorporate min/max size
-	bool bNewOrigSize = getArea()->checkSplitterRectWithChildAreaMinSizesAndAutoFold(m_rctCurrent);
-		
-	// enforce the new rect if necessary
-	if( rctOld != m_rctCurrent )
+	bool bNewOrigSize = getArea()->checkSplitterRectWithChildAreaMinSizesAndAutoFold(m_nIndex, m_rctCurrent);
+
+	// enforce the new rect if necessary. The area may have aligned the splitter before already,
+	// so the rect is compared to where it was drawn.
+	if( m_rctApplied != m_rctCurrent )
 	{
-		MoveWindow(m_rctCurrent, true);
-		getManager()->getWnd()->InvalidateRect(&m_rctCurrent, TRUE);
+		invalidate(m_rctApplied);
+		invalidate(m_rctCurrent);
+		m_rctApplied = m_rctCurrent;
+		updateHitTestEntry();
 		if(bNewOrigSize)
-			getManager()->updateAllOrigRect();
+		{
+			LAYOUT_TIME_PHASE(getManager()->m_pPhaseClock, PhaseInvalidate);
+			const_cast<Area*>(getArea())->rebaseOrigRect();
+		}
 	}
 }
 
-void Layout::Splitter::DrawItem( LPDRAWITEMSTRUCT lpDrawItemStruct )
+void Splitter::alignRect()
+{
+	// update horizontal and vertical alignment
+	m_aHorzAlign.update(this, Align::Horizontal, m_rctCurrent);
+	m_aVertAlign.update(this, Align::Vertical, m_rctCurrent);
+}
+
+void Splitter::invalidate( CRect const& rctLayout ) const
 {
-	if(m_hHandleColor == NULL)
+	LAYOUT_TIME_PHASE(getManager()->m_pPhaseClock, PhaseInvalidate);
+	CRect rctClient(rctLayout);
+	rctClient.OffsetRect(-getManager()->getViewportOrigin());
+	::InvalidateRect(getManager()->getHwnd(), &rctClient, TRUE);
+}
+
+void Splitter::updateHitTestEntry() const
+{
+	getManager()->m_pHitTestIndex->update(HitTestIndex::Element(HitTestIndex::KindSplitter, const_cast<Splitter*>(this)), m_rctCurrent);
+}
+
+void Layout::Splitter::draw( HDC hDC ) const
+{
+	if(m_hHandleColor == NULL || !isShown())
 		return;
-	
+
 	const int iDotSpacing = 4;
 	const int iDotSize = 5;
-	
-	HDC hDC = lpDrawItemStruct->hDC;
-	CRect rctSplitter = lpDrawItemStruct->rcItem;
+
+	CRect const& rctSplitter = m_rctCurrent;
 	int iSize = iDotSpacing * 2 + iDotSize * 3;
 	POINT ptHandle;
-	
+
 	// Reduce rect to size
 	if(getOrientation() == Horizontal)
 	{
-		ptHandle.x = (rctSplitter.Width() - iSize)/2;
+		ptHandle.x = rctSplitter.left + (rctSplitter.Width() - iSize)/2;
 		ptHandle.y = rctSplitter.top;
 	}
 	else
 	{
-		ptHandle.y = (rctSplitter.Height() - iSize)/2;
+		ptHandle.y = rctSplitter.top + (rctSplitter.Height() - iSize)/2;
 		ptHandle.x = rctSplitter.left;
 	}
-	
+
 	for( int i = 0; i < 3; ++i)
 	{
 		gdiPlusUtil.drawEllipse(hDC, ptHandle.x, ptHandle.y, iDotSize, iDotSize, m_hHandleColor);
@@ -195,7 +313,7 @@ void Layout::Splitter::DrawItem( LPDRAWITEMSTRUCT lpDrawItemStruct )
 		else
 			ptHandle.y += iDotSpacing + iDotSize;
 	}
-	
+
 	return;
 }
 
@@ -204,3 +322,12 @@ void Layout::Splitter::setHandleColor( COLORREF hColor )
 	m_hHandleColor = hColor;
 }
 
+void Splitter::recordDrag( int nEventKind, CPoint point ) const
+{
+	MessageRecorder* pRecorder = getManager()->m_pMessageRecorder;
+	if(!pRecorder)
+		return;
+
+	// Recorded in client coords of the managed window, the splitter is found by hit-testing when the event is replayed
+	pRecorder->record((MessageTrace::EventKind) nEventKind, 0, 0, point.x, point.y);
+}
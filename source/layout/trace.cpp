@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/trace.h"
+
+#include <algorithm>
+#include <vector>
+#include <sstream>
+
+#include <boost/cstdint.hpp>
+
+using namespace Layout;
+
+namespace
+{
+struct TraceEvent
+{
+	char const* pchName;
+	boost::int64_t nTicks;
+	int iDepth;
+	char chPhase;       /// 'B'egin, 'E'nd or 'i'nstant, as in the Chrome trace format
+	char achDetail[39];
+};
+
+/** The ring buffer of one thread. Only the owning thread writes events, flush() only reads them. */
+struct ThreadBuffer
+{
+	DWORD nThreadId;
+	volatile LONG nWritten; /// Number of events written so far. Event n is at n % BufferCapacity.
+	LONG nFlushed;          /// Number of events delivered by flush(). Only touched by flush().
+	TraceEvent aEvents[Trace::BufferCapacity];
+};
+
+/** The buffers of all threads which ever recorded an event. They are never freed,
+    so the events of a thread which has exited can still be flushed. */
+struct TraceRegistry
+{
+	DWORD nTlsIndex;
+	boost::int64_t nEpoch;
+	double dTicksPerUs;
+	CRITICAL_SECTION aSection;
+	std::vector<ThreadBuffer*> vBuffers;
+
+	TraceRegistry()
+	{
+		nTlsIndex = ::TlsAlloc();
+		::InitializeCriticalSection(&aSection);
+
+		LARGE_INTEGER nValue;
+		::QueryPerformanceFrequency(&nValue);
+		dTicksPerUs = (double) nValue.QuadPart / 1000000.0;
+		::QueryPerformanceCounter(&nValue);
+		nEpoch = nValue.QuadPart;
+	}
+} s_aRegistry;
+
+ThreadBuffer* GetThreadBuffer()
+{
+	ThreadBuffer* pBuffer = (ThreadBuffer*) ::TlsGetValue(s_aRegistry.nTlsIndex);
+	if(pBuffer)
+		return pBuffer;
+
+	pBuffer = new ThreadBuffer;
+	pBuffer->nThreadId = ::GetCurrentThreadId();
+	pBuffer->nWritten = 0;
+	pBuffer->nFlushed = 0;
+	::TlsSetValue(s_aRegistry.nTlsIndex, pBuffer);
+
+	::EnterCriticalSection(&s_aRegistry.aSection);
+	s_aRegistry.vBuffers.push_back(pBuffer);
+	::LeaveCriticalSection(&s_aRegistry.aSection);
+
+	return pBuffer;
+}
+
+void Record(char chPhase, char const* pchName, char const* pchDetail, int iDepth)
+{
+	ThreadBuffer* pBuffer = GetThreadBuffer();
+	LONG nIndex = pBuffer->nWritten;
+	TraceEvent& aEvent = pBuffer->aEvents[nIndex % Trace::BufferCapacity];
+
+	LARGE_INTEGER nNow;
+	::QueryPerformanceCounter(&nNow);
+
+	aEvent.pchName = pchName;
+	aEvent.nTicks = nNow.QuadPart;
+	aEvent.iDepth = iDepth;
+	aEvent.chPhase = chPhase;
+	aEvent.achDetail[0] = 0;
+	if(pchDetail)
+	{
+		size_t nChar = 0;
+		for(; pchDetail[nChar] && nChar < sizeof(aEvent.achDetail) - 1; ++nChar)
+			aEvent.achDetail[nChar] = pchDetail[nChar];
+		aEvent.achDetail[nChar] = 0;
+	}
+
+	// Publishes the event to flush()
+	::InterlockedExchange(&pBuffer->nWritten, nIndex + 1);
+}
+
+void AppendEscaped(char const* pchValue, std::ostringstream& aStream)
+{
+	for(; *pchValue; ++pchValue)
+	{
+		if(*pchValue == '"' || *pchValue == '\\')
+			aStream << '\\';
+		aStream << ((unsigned char) *pchValue < 0x20 ? ' ' : *pchValue);
+	}
+}
+}
+
+void Trace::begin( char const* pchName, char const* pchDetail /*= NULL*/, int iDepth /*= -1*/ )
+{
+	Record('B', pchName, pchDetail, iDepth);
+}
+
+void Trace::end( char const* pchName )
+{
+	Record('E', pchName, NULL, -1);
+}
+
+void Trace::instant( char const* pchName, char const* pchDetail /*= NULL*/, int iDepth /*= -1*/ )
+{
+	Record('i', pchName, pchDetail, iDepth);
+}
+
+void Trace::flush( std::string& sResult )
+{
+	std::ostringstream aStream;
+	aStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool bFirst = true;
+	DWORD nProcessId = ::GetCurrentProcessId();
+	std::vector<TraceEvent> vEvents;
+
+	::EnterCriticalSection(&s_aRegistry.aSection);
+	for each(ThreadBuffer* pBuffer in s_aRegistry.vBuffers)
+	{
+		LONG nEnd = ::InterlockedCompareExchange(&pBuffer->nWritten, 0, 0);
+		LONG nBegin = std::max(pBuffer->nFlushed, nEnd - (LONG) BufferCapacity);
+
+		vEvents.clear();
+		for(LONG nIndex = nBegin; nIndex < nEnd; ++nIndex)
+			vEvents.push_back(pBuffer->aEvents[nIndex % BufferCapacity]);
+
+		// The thread kept writing while the events were copied. The slots it may have
+		// reused, including the one of the event it is writing right now, are dropped.
+		LONG nAfter = ::InterlockedCompareExchange(&pBuffer->nWritten, 0, 0);
+		LONG nValidBegin = std::max(nBegin, nAfter - (LONG) BufferCapacity + 1);
+		pBuffer->nFlushed = nEnd;
+
+		for(LONG nIndex = nValidBegin; nIndex < nEnd; ++nIndex)
+		{
+			TraceEvent const& aEvent = vEvents[nIndex - nBegin];
+
+			aStream << (bFirst ? "" : ",") << "{\"name\":\"";
+			AppendEscaped(aEvent.pchName, aStream);
+			aStream << "\",\"ph\":\"" << aEvent.chPhase
+				<< "\",\"ts\":" << (double) (aEvent.nTicks - s_aRegistry.nEpoch) / s_aRegistry.dTicksPerUs
+				<< ",\"pid\":" << nProcessId
+				<< ",\"tid\":" << pBuffer->nThreadId;
+			if(aEvent.chPhase == 'i')
+				aStream << ",\"s\":\"t\"";
+			if(aEvent.achDetail[0] || aEvent.iDepth >= 0)
+			{
+				aStream << ",\"args\":{\"detail\":\"";
+				AppendEscaped(aEvent.achDetail, aStream);
+				aStream << "\",\"depth\":" << aEvent.iDepth << "}";
+			}
+			aStream << "}";
+			bFirst = false;
+		}
+	}
+	::LeaveCriticalSection(&s_aRegistry.aSection);
+
+	aStream << "]}";
+	sResult += aStream.str();
+}
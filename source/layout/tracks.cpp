@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#pragma hdrstop
+
+#include "../../GlobExport/tracks.h"
+
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+
+using namespace Layout;
+
+Tracks::Tracks( int iGap ) :
+	m_iGap(iGap)
+{
+}
+
+void Tracks::add( Kind nKind, int iValue )
+{
+	m_vTracks.push_back(Track(nKind, iValue));
+	m_vnContent.push_back(0);
+	m_viEdges.clear();
+}
+
+void Tracks::clear()
+{
+	m_vTracks.clear();
+	m_vnContent.clear();
+	m_viEdges.clear();
+}
+
+void Tracks::resetContent()
+{
+	std::fill(m_vnContent.begin(), m_vnContent.end(), 0);
+}
+
+void Tracks::fitContent( size_t nIndex, size_t nSpan, int iSize )
+{
+	if(nSpan != 1 || nIndex >= m_vTracks.size() || m_vTracks[nIndex].nKind != KindAuto)
+		return;
+
+	m_vnContent[nIndex] = std::max(m_vnContent[nIndex], iSize);
+}
+
+int Tracks::getMinSize() const
+{
+	if(m_vTracks.empty())
+		return 0;
+
+	int iResult = m_iGap * (int) (m_vTracks.size() - 1);
+	for(size_t nIndex = 0; nIndex < m_vTracks.size(); ++nIndex)
+	{
+		if(m_vTracks[nIndex].nKind == KindFixed)
+			iResult += m_vTracks[nIndex].iValue;
+		else if(m_vTracks[nIndex].nKind == KindAuto)
+			iResult += m_vnContent[nIndex];
+	}
+	return iResult;
+}
+
+void Tracks::layout( int iStart, int iLength )
+{
+	int iWeights = 0;
+	for each(Track const& aTrack in m_vTracks)
+	{
+		if(aTrack.nKind == KindProportional)
+			iWeights += std::max(aTrack.iValue, 0);
+	}
+
+	// Below the minimum size, the proportional tracks get nothing and the last tracks are cut off
+	int iFree = std::max(iLength - getMinSize(), 0);
+
+	m_viEdges.resize(m_vTracks.size() * 2);
+	int iPos = iStart;
+	int iWeightsBefore = 0;
+	for(size_t nIndex = 0; nIndex < m_vTracks.size(); ++nIndex)
+	{
+		Track const& aTrack = m_vTracks[nIndex];
+		int iSize = 0;
+		if(aTrack.nKind == KindFixed)
+			iSize = aTrack.iValue;
+		else if(aTrack.nKind == KindAuto)
+			iSize = m_vnContent[nIndex];
+		else if(iWeights > 0)
+		{
+			int iWeightsAfter = iWeightsBefore + std::max(aTrack.iValue, 0);
+			iSize = (int) (((boost::int64_t) iFree * iWeightsAfter + iWeights / 2) / iWeights - ((boost::int64_t) iFree * iWeightsBefore + iWeights / 2) / iWeights);
+			iWeightsBefore = iWeightsAfter;
+		}
+
+		if(nIndex > 0)
+			iPos += m_iGap;
+		m_viEdges[nIndex * 2] = iPos;
+		iPos += iSize;
+		m_viEdges[nIndex * 2 + 1] = iPos;
+	}
+}
+
+bool Tracks::getSpan( size_t nIndex, size_t nSpan, int& iStart, int& iEnd ) const
+{
+	if(nSpan == 0 || m_viEdges.empty() || nIndex + nSpan > m_vTracks.size())
+		return false;
+
+	iStart = m_viEdges[nIndex * 2];
+	iEnd = m_viEdges[(nIndex + nSpan - 1) * 2 + 1];
+	return true;
+}
+
+void Tracks::appendFingerprint( std::vector<int>& vFingerprint ) const
+{
+	vFingerprint.push_back((int) m_vTracks.size());
+	vFingerprint.push_back(m_iGap);
+	for each(Track const& aTrack in m_vTracks)
+	{
+		vFingerprint.push_back(aTrack.nKind);
+		vFingerprint.push_back(aTrack.iValue);
+	}
+}
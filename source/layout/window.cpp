@@ -39,6 +39,9 @@ Window::~Window()
 void Layout::Window::initWindow()
 {
 	AFXASSUME(m_aChildLayout.getHwnd());
+
+	// The child layout needs a parent window, other areas are windowless
+	CreateLayoutAreaWindow();
 	m_aChildLayout.setParent(this->GetSafeHwnd());
 	::MoveWindow(m_aChildLayout.getHwnd(),
 		m_rctCurrentVisibleShape.left,
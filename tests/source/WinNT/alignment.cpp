@@ -34,14 +34,21 @@ public:
 		return new Layout::Area((const Layout::Manager *)NULL, frame, CSize(0, 0), CSize(0, 0));
 	}
 	
+	static void DeleteArea(Layout::Area* area)
+	{
+		delete area;
+	}
+	
 	static void AreaSetOrigRect(Layout::Area* area, const CRect& rect)
 	{
 		area->m_rctOrigClientShape = rect;
+		area->updateRelativeScale();
 	}
 	
 	static void AreaSetClientRect(Layout::Area* area, const CRect& rect)
 	{
 		area->m_rctCurrentClientShape = rect;
+		area->updateRelativeScale();
 	}
 };
 
@@ -130,4 +137,80 @@ public:
 		alignment.update(control, Layout::Align::Horizontal, outRect);
 		Assert::IsTrue(outRect == CRect(25, 25, 175, 75));
 	}
+	
+	[Test]
+	void policySlots()
+	{
+		Layout::Control* control = LayoutTest::CreateControl();
+		Layout::Area* area = LayoutTest::CreateArea(CRect(0, 0, 100, 100));
+		
+		LayoutTest::ControlSetOrigRect(control, CRect(25, 25, 75, 75));
+		LayoutTest::AreaSetOrigRect(area, CRect(0, 0, 100, 100));
+		typedef Layout::Align::Policy<Layout::Align::Resize, Layout::Align::BottomRight> Policy;
+		CRect outRect(25, 25, 75, 75);
+		
+		control->setAlignmentArea(area);
+		
+		Assert::IsTrue(Policy::horz().nKind == Layout::Align::KindResize && Policy::horz().pMode == NULL);
+		Assert::IsTrue(Layout::Align::TopLeft().getSlot().nKind == Layout::Align::KindTopLeft);
+		
+		LayoutTest::AreaSetClientRect(area, CRect(0, 0, 200, 200));
+		
+		Policy::horz().update(control, Layout::Align::Horizontal, outRect);
+		Policy::vert().update(control, Layout::Align::Vertical, outRect);
+		Assert::IsTrue(outRect == CRect(25, 125, 175, 175));
+	}
+	
+	[Test]
+	void deleteAreaWithoutManager()
+	{
+		Layout::Area* area = LayoutTest::CreateArea(CRect(0, 0, 100, 100));
+		LayoutTest::DeleteArea(area);
+	}
+	
+	[Test]
+	void handedOutModeIsDispatched()
+	{
+		Layout::Control* control = LayoutTest::CreateControl();
+		Layout::Area* area = LayoutTest::CreateArea(CRect(0, 0, 100, 100));
+		
+		LayoutTest::ControlSetOrigRect(control, CRect(25, 25, 75, 75));
+		LayoutTest::AreaSetOrigRect(area, CRect(0, 0, 100, 100));
+		CRect outRect(25, 25, 75, 75);
+		
+		control->setAlignmentArea(area);
+		Assert::IsTrue(control->getHorzSlot().nKind == Layout::Align::KindTopLeft);
+		
+		// Once handed out, the mode is what aligns the control
+		Layout::Align::Mode* mode = control->getHorzAlignment();
+		Assert::IsTrue(control->getHorzSlot().nKind == Layout::Align::KindCustom && control->getHorzSlot().pMode == mode);
+		Assert::IsTrue(control->getHorzAlignment() == mode);
+		
+		LayoutTest::AreaSetClientRect(area, CRect(0, 0, 200, 200));
+		control->getHorzSlot().update(control, Layout::Align::Horizontal, outRect);
+		Assert::IsTrue(outRect == CRect(25, 25, 75, 75));
+	}
+	
+	[Test]
+	void relativeRoundTrip()
+	{
+		Layout::Control* control = LayoutTest::CreateControl();
+		Layout::Area* area = LayoutTest::CreateArea(CRect(0, 0, 300, 300));
+		
+		LayoutTest::ControlSetOrigRect(control, CRect(100, 100, 200, 200));
+		LayoutTest::AreaSetOrigRect(area, CRect(0, 0, 300, 300));
+		CRect outRect(100, 100, 200, 200);
+		
+		control->setAlignmentArea(area);
+		
+		// 100 * 200 / 300 is 66.67, truncating gave 66
+		LayoutTest::AreaSetClientRect(area, CRect(0, 0, 200, 200));
+		Layout::Align::Slot(Layout::Align::KindRelativeResize).update(control, Layout::Align::Horizontal, outRect);
+		Assert::IsTrue(outRect.left == 67 && outRect.right == 133);
+		
+		// Back at the orig size, the control is exactly where it started
+		LayoutTest::AreaSetClientRect(area, CRect(0, 0, 300, 300));
+		Layout::Align::Slot(Layout::Align::KindRelativeResize).update(control, Layout::Align::Horizontal, outRect);
+		Assert::IsTrue(outRect.left == 100 && outRect.right == 200);
+	}
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include <vector>
+
+#include "Base/DynLayout/GlobExport/description.h"
+
+static char const* s_pchDescription =
+	"# Two lists with a splitter in between\n"
+	"control list    1001 resize:40 resize\n"
+	"control details 1002 resize    resize\n"
+	"control ok      1003 bottomright bottomright\n"
+	"splitter list details vertical relative\n"
+	"area list foldable title=\"Items\" background=#102030\n";
+
+[TestFixture]
+ref class DescriptionTest
+{
+public:
+	[Test]
+	void parse()
+	{
+		Layout::Description aDescription;
+		Assert::IsTrue(aDescription.parse(s_pchDescription));
+
+		Assert::IsTrue(aDescription.getControlCount() == 3);
+		Assert::IsTrue(aDescription.getSplitterCount() == 1);
+		Assert::IsTrue(aDescription.getAreaCount() == 1);
+
+		Layout::Description::ControlEntry const& aList = aDescription.getControl(0);
+		Assert::IsTrue(aList.nId == 1001);
+		Assert::IsTrue(aList.nHorz == Layout::Description::AlignResize);
+		Assert::IsTrue(aList.nHorzMin == 40);
+		Assert::IsTrue(aDescription.findControl("ok") == 2);
+
+		Layout::Description::SplitterEntry const& aSplitter = aDescription.getSplitter(0);
+		Assert::IsTrue(aSplitter.nHigh == 0 && aSplitter.nLow == 1);
+		Assert::IsTrue(aSplitter.nOrientation == Layout::Description::SplitVertical);
+		Assert::IsTrue(aSplitter.nAlignment == Layout::Description::SplitAlignRelative);
+
+		Layout::Description::AreaEntry const& aArea = aDescription.getArea(0);
+		Assert::IsTrue(std::string(aDescription.getString(aArea.nTitle)) == "Items");
+		Assert::IsTrue(aArea.crBk == 0x302010);
+		Assert::IsTrue((aArea.nStyle & Layout::Description::StyleFoldable) != 0);
+	}
+
+	[Test]
+	void binaryRoundTrip()
+	{
+		Layout::Description aDescription;
+		Assert::IsTrue(aDescription.parse(s_pchDescription));
+
+		std::vector<char> vImage;
+		aDescription.toBinary(vImage);
+
+		Layout::Description aLoaded;
+		Assert::IsTrue(aLoaded.loadBinary(&vImage[0], vImage.size(), false));
+		Assert::IsTrue(aLoaded.getControlCount() == 3);
+		Assert::IsTrue(std::string(aLoaded.getString(aLoaded.getControl(1).nName)) == "details");
+
+		// A truncated image must be rejected
+		Assert::IsFalse(aLoaded.loadBinary(&vImage[0], vImage.size() - 1));
+		Assert::IsTrue(aLoaded.getControlCount() == 0);
+	}
+
+	[Test]
+	void loadsUnalignedImage()
+	{
+		Layout::Description aDescription;
+		Assert::IsTrue(aDescription.parse(s_pchDescription));
+
+		std::vector<char> vImage;
+		aDescription.toBinary(vImage);
+		std::vector<char> vShifted(1, 'x');
+		vShifted.insert(vShifted.end(), vImage.begin(), vImage.end());
+
+		Layout::Description aLoaded;
+		Assert::IsTrue(aLoaded.loadBinary(&vShifted[1], vImage.size(), false));
+		Assert::IsTrue(aLoaded.getControl(2).nId == 1003);
+
+		// The tables were copied, the buffer may go away
+		vShifted.assign(vShifted.size(), 0);
+		Assert::IsTrue(aLoaded.getSplitter(0).nLow == 1);
+	}
+
+	[Test]
+	void rejectsOverflowingCounts()
+	{
+		Layout::Description aDescription;
+		Assert::IsTrue(aDescription.parse(s_pchDescription));
+
+		std::vector<char> vImage;
+		aDescription.toBinary(vImage);
+
+		// The control count follows magic and version. A count, whose table size wraps around, must not pass.
+		unsigned int nControls = 0xFFFFFFFF;
+		memcpy(&vImage[8], &nControls, sizeof(nControls));
+
+		Layout::Description aLoaded;
+		Assert::IsFalse(aLoaded.loadBinary(&vImage[0], vImage.size(), false));
+		Assert::IsTrue(aLoaded.getControlCount() == 0);
+	}
+
+	[Test]
+	void parseError()
+	{
+		Layout::Description aDescription;
+		std::string sError;
+		Assert::IsFalse(aDescription.parse("control a 1 topleft topleft\nsplitter a b horizontal high\n", &sError));
+		Assert::IsTrue(sError.find("line 2") == 0);
+		Assert::IsTrue(aDescription.getControlCount() == 0);
+	}
+};
@@ -0,0 +1,136 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include "Base/DynLayout/GlobExport/manager.h"
+#include "Base/DynLayout/GlobExport/alignment.h"
+#include "Base/DynLayout/GlobExport/tracks.h"
+#include "Base/DynLayout/GlobExport/area.h"
+#include "Base/DynLayout/GlobExport/splitter.h"
+
+#include "testwindow.h"
+
+[TestFixture]
+ref class GridTest
+{
+public:
+	[Test]
+	void placesControlsInTracks()
+	{
+		TestWindow window(200, 100);
+		HWND hA = window.addChild(1001, CRect(0, 0, 30, 20));
+		HWND hB = window.addChild(1002, CRect(50, 0, 100, 25));
+		HWND hC = window.addChild(1003, CRect(0, 30, 30, 60));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			Assert::IsTrue(manager.addControl(hA, Layout::Align::Track::slot(0), Layout::Align::Track::slot(0), "a"));
+			Assert::IsTrue(manager.addControl(hB, Layout::Align::Track::slot(1, 2), Layout::Align::Track::slot(0), "b"));
+			Assert::IsTrue(manager.addControl(hC, Layout::Align::Track::slot(0), Layout::Align::Track::slot(1), "c"));
+			
+			Layout::Tracks columns(10);
+			columns.add(Layout::Tracks::KindFixed, 40);
+			columns.add(Layout::Tracks::KindProportional, 1);
+			columns.add(Layout::Tracks::KindProportional, 1);
+			Layout::Tracks rows(10);
+			rows.add(Layout::Tracks::KindAuto);
+			rows.add(Layout::Tracks::KindProportional, 1);
+			manager.setGrid(NULL, columns, rows);
+			
+			// Columns: 40 + 2 gaps, 240 left for two equal shares. Rows: the auto row fits the higher of a and b.
+			window.resize(manager, 300, 200);
+			Assert::IsTrue(window.getChildRect(hA) == CRect(0, 0, 40, 25));
+			Assert::IsTrue(window.getChildRect(hB) == CRect(50, 0, 300, 25));
+			Assert::IsTrue(window.getChildRect(hC) == CRect(0, 35, 40, 200));
+		}
+	}
+	
+	[Test]
+	void minSizeIsTheSumOfTheTracks()
+	{
+		TestWindow window(200, 100);
+		HWND hA = window.addChild(1001, CRect(0, 0, 30, 20));
+		HWND hB = window.addChild(1002, CRect(0, 30, 30, 60));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			manager.addControl(hA, Layout::Align::Track::slot(0), Layout::Align::Track::slot(0), "a");
+			manager.addControl(hB, Layout::Align::Track::slot(1), Layout::Align::Track::slot(1), "b");
+			
+			Layout::Tracks columns(5);
+			columns.add(Layout::Tracks::KindAuto);
+			columns.add(Layout::Tracks::KindFixed, 50);
+			columns.add(Layout::Tracks::KindProportional, 1);
+			Layout::Tracks rows;
+			rows.add(Layout::Tracks::KindAuto);
+			rows.add(Layout::Tracks::KindAuto);
+			manager.setGrid(NULL, columns, rows);
+			
+			// Proportional tracks add nothing but their gap
+			Assert::IsTrue(TestWindow::getMinTrackSize(manager) == CSize(30 + 50 + 2 * 5, 20 + 30));
+		}
+	}
+	
+	[Test]
+	void stackOrdersByOrigPosition()
+	{
+		TestWindow window(200, 100);
+		HWND hC = window.addChild(1003, CRect(100, 10, 130, 30));
+		HWND hA = window.addChild(1001, CRect(0, 10, 20, 30));
+		HWND hB = window.addChild(1002, CRect(40, 10, 70, 30));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			
+			// Added out of order, the stack follows the orig left edges
+			manager.addControl(hC, Layout::Align::Traits<Layout::Align::TopLeft>::slot(), Layout::Align::Traits<Layout::Align::TopLeft>::slot(), "c");
+			manager.addControl(hA, Layout::Align::Traits<Layout::Align::TopLeft>::slot(), Layout::Align::Traits<Layout::Align::TopLeft>::slot(), "a");
+			manager.addControl(hB, Layout::Align::Traits<Layout::Align::TopLeft>::slot(), Layout::Align::Traits<Layout::Align::TopLeft>::slot(), "b");
+			manager.setStack(NULL, Layout::Align::Horizontal, 5);
+			
+			window.resize(manager, 300, 100);
+			Assert::IsTrue(window.getChildRect(hA) == CRect(0, 10, 20, 30));
+			Assert::IsTrue(window.getChildRect(hB) == CRect(25, 10, 55, 30));
+			Assert::IsTrue(window.getChildRect(hC) == CRect(60, 10, 90, 30));
+			Assert::IsTrue(TestWindow::getMinTrackSize(manager).cx == 20 + 30 + 30 + 2 * 5);
+		}
+	}
+	
+	[Test]
+	void memoizedPassMovesTracks()
+	{
+		TestWindow window(400, 200);
+		HWND hLeft = window.addChild(1001, CRect(10, 10, 190, 190));
+		HWND hA = window.addChild(1002, CRect(210, 10, 290, 190));
+		HWND hB = window.addChild(1003, CRect(300, 10, 390, 190));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			manager.setLayoutCacheSize(8);
+			manager.addControl(hLeft, Layout::Align::Slot(Layout::Align::KindResize), Layout::Align::Slot(Layout::Align::KindResize), "left");
+			manager.addControl(hA, Layout::Align::Track::slot(0), Layout::Align::Track::slot(0), "a");
+			manager.addControl(hB, Layout::Align::Track::slot(1), Layout::Align::Track::slot(0), "b");
+			Layout::Splitter const* pSplitter = manager.putSplitter(hLeft, hA, Layout::Splitter::Vertical, Layout::Splitter::AlignRelative);
+			Layout::Area const* pRight = pSplitter->getArea()->getChild(1);
+			
+			Layout::Tracks columns(10);
+			columns.add(Layout::Tracks::KindProportional, 1);
+			columns.add(Layout::Tracks::KindProportional, 1);
+			Layout::Tracks rows;
+			rows.add(Layout::Tracks::KindProportional, 1);
+			manager.setGrid(pRight, columns, rows);
+			
+			// The key of a pass holds the splitter rects before it, so the fourth pass repeats the second one
+			int iStart = 0, iEnd = 0;
+			window.resize(manager, 300, 200);
+			window.resize(manager, 500, 200);
+			Assert::IsTrue(pRight->getTracks(Layout::Align::Horizontal).getSpan(1, 1, iStart, iEnd));
+			window.resize(manager, 300, 200);
+			window.resize(manager, 500, 200);
+			Assert::IsTrue(manager.getPassCounters().nMemoized == 1);
+			
+			int iMemoizedStart = 0, iMemoizedEnd = 0;
+			Assert::IsTrue(pRight->getTracks(Layout::Align::Horizontal).getSpan(1, 1, iMemoizedStart, iMemoizedEnd));
+			Assert::IsTrue(iMemoizedStart == iStart && iMemoizedEnd == iEnd);
+			Assert::IsTrue(iEnd == pRight->getClientRect().right);
+		}
+	}
+};
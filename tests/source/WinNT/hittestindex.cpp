@@ -0,0 +1,64 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include <vector>
+
+#include "Base/DynLayout/GlobExport/hittestindex.h"
+
+[TestFixture]
+ref class HitTestIndexTest
+{
+public:
+	[Test]
+	void pointQueryExcludesRightAndBottomEdge()
+	{
+		// The elements are never dereferenced, so any distinct pointers do
+		Layout::Area* pArea = reinterpret_cast<Layout::Area*>(0x10);
+		Layout::Control* pControl = reinterpret_cast<Layout::Control*>(0x20);
+
+		Layout::HitTestIndex aIndex;
+		aIndex.update(Layout::HitTestIndex::Element(pArea), CRect(0, 0, 100, 100));
+		aIndex.update(Layout::HitTestIndex::Element(Layout::HitTestIndex::KindControl, pControl), CRect(10, 10, 50, 30));
+
+		std::vector<Layout::HitTestIndex::Element> vResult;
+		aIndex.queryPoint(CPoint(20, 20), vResult);
+		Assert::IsTrue(vResult.size() == 2);
+
+		vResult.clear();
+		aIndex.queryPoint(CPoint(50, 20), vResult);
+		Assert::IsTrue(vResult.size() == 1 && vResult[0].pArea == pArea);
+
+		vResult.clear();
+		aIndex.queryPoint(CPoint(100, 20), vResult);
+		Assert::IsTrue(vResult.empty());
+	}
+
+	[Test]
+	void updateMovesAndRemoves()
+	{
+		Layout::Control* pControl = reinterpret_cast<Layout::Control*>(0x20);
+		Layout::HitTestIndex::Element aElement(Layout::HitTestIndex::KindSplitter, pControl);
+
+		Layout::HitTestIndex aIndex;
+		aIndex.update(aElement, CRect(0, 50, 200, 56));
+		aIndex.update(aElement, CRect(0, 80, 200, 86));
+		Assert::IsTrue(aIndex.size() == 1);
+
+		std::vector<Layout::HitTestIndex::Element> vResult;
+		aIndex.queryPoint(CPoint(10, 52), vResult);
+		Assert::IsTrue(vResult.empty());
+		aIndex.queryIntersecting(CRect(0, 0, 20, 100), vResult);
+		Assert::IsTrue(vResult.size() == 1 && vResult[0] == aElement);
+
+		// A folded splitter cannot be hit
+		aIndex.update(aElement, CRect(0, 80, 200, 80));
+		Assert::IsTrue(aIndex.size() == 0);
+
+		aIndex.update(aElement, CRect(0, 80, 200, 86));
+		aIndex.remove(aElement);
+		Assert::IsTrue(aIndex.size() == 0);
+	}
+};
@@ -0,0 +1,73 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include "Base/DynLayout/GlobExport/layoutcache.h"
+
+namespace
+{
+	Layout::LayoutCache::Key MakeKey(int iWidth)
+	{
+		Layout::LayoutCache::Key aKey;
+		aKey.rctRoot = CRect(0, 0, iWidth, 300);
+		aKey.rctWindowClient = aKey.rctRoot;
+		aKey.vSplitters.push_back(CRect(0, 100, iWidth, 106));
+		aKey.vnFolded.resize(3, 0);
+		return aKey;
+	}
+
+	Layout::LayoutCache::Result MakeResult(int iWidth)
+	{
+		Layout::LayoutCache::Result aResult;
+		aResult.vControls.push_back(CRect(10, 10, iWidth - 10, 90));
+		return aResult;
+	}
+}
+
+[TestFixture]
+ref class LayoutCacheTest
+{
+public:
+	[Test]
+	void evictsLeastRecentlyUsed()
+	{
+		Layout::LayoutCache aCache(2);
+		aCache.store(MakeKey(400), MakeResult(400));
+		aCache.store(MakeKey(800), MakeResult(800));
+
+		// Using 400 makes 800 the least recently used entry
+		Layout::LayoutCache::Result const* pResult = aCache.find(MakeKey(400));
+		Assert::IsTrue(pResult != NULL && pResult->vControls[0].right == 390);
+
+		aCache.store(MakeKey(1200), MakeResult(1200));
+		Assert::IsTrue(aCache.size() == 2);
+		Assert::IsTrue(aCache.find(MakeKey(800)) == NULL);
+		Assert::IsTrue(aCache.find(MakeKey(400)) != NULL);
+		Assert::IsTrue(aCache.find(MakeKey(1200)) != NULL);
+	}
+
+	[Test]
+	void keyIncludesFoldStates()
+	{
+		Layout::LayoutCache aCache(4);
+		aCache.store(MakeKey(400), MakeResult(400));
+
+		Layout::LayoutCache::Key aFolded = MakeKey(400);
+		aFolded.vnFolded[1] = 1;
+		Assert::IsTrue(aCache.find(aFolded) == NULL);
+	}
+
+	[Test]
+	void clearStartsNewGeneration()
+	{
+		Layout::LayoutCache aCache(4);
+		aCache.store(MakeKey(400), MakeResult(400));
+		unsigned int nGeneration = aCache.getGeneration();
+
+		aCache.clear();
+		Assert::IsTrue(aCache.size() == 0);
+		Assert::IsTrue(aCache.getGeneration() != nGeneration);
+	}
+};
@@ -0,0 +1,66 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include "Base/DynLayout/GlobExport/layouttemplate.h"
+
+[TestFixture]
+ref class LayoutTemplateTest
+{
+public:
+	[Test]
+	void parsesOncePerIdentifier()
+	{
+		Layout::LayoutTemplate::clearAll();
+		Layout::LayoutTemplate::Ptr pFirst = Layout::LayoutTemplate::forDescription("TemplateTest", "control a 1001 resize resize\n");
+		Assert::IsTrue(pFirst && pFirst->getDescription().getControlCount() == 1);
+
+		// A second instance with the same text gets the same template
+		Layout::LayoutTemplate::Ptr pSecond = Layout::LayoutTemplate::forDescription("TemplateTest", "control a 1001 resize resize\n");
+		Assert::IsTrue(pSecond == pFirst);
+		Assert::IsTrue(Layout::LayoutTemplate::find("TemplateTest") == pFirst);
+		Assert::IsTrue(!Layout::LayoutTemplate::find("OtherTemplateTest"));
+	}
+
+	[Test]
+	void reparsesChangedText()
+	{
+		Layout::LayoutTemplate::clearAll();
+		Layout::LayoutTemplate::Ptr pFirst = Layout::LayoutTemplate::forDescription("TemplateTest", "control a 1001 resize resize\n");
+
+		Layout::LayoutTemplate::Ptr pChanged = Layout::LayoutTemplate::forDescription("TemplateTest", "control a 1001 resize resize\ncontrol b 1002 resize resize\n");
+		Assert::IsTrue(pChanged && pChanged != pFirst);
+		Assert::IsTrue(pChanged->getDescription().getControlCount() == 2);
+		Assert::IsTrue(Layout::LayoutTemplate::find("TemplateTest") == pChanged);
+	}
+
+	[Test]
+	void emptyIdentifierIsNotShared()
+	{
+		Layout::LayoutTemplate::clearAll();
+		Layout::LayoutTemplate::Ptr pFirst = Layout::LayoutTemplate::forDescription("", "control a 1001 resize resize\n");
+		Layout::LayoutTemplate::Ptr pSecond = Layout::LayoutTemplate::forDescription("", "control b 1002 topleft topleft\n");
+		Assert::IsTrue(pFirst && pSecond && pFirst != pSecond);
+		Assert::IsTrue(pSecond->getDescription().findControl("b") == 0);
+		Assert::IsTrue(!Layout::LayoutTemplate::find(""));
+	}
+
+	[Test]
+	void matchesFingerprintWithMinSizes()
+	{
+		std::vector<int> vFingerprint(3, 7);
+		std::vector<SIZE> vMinSizes;
+		Layout::LayoutTemplate aEmpty(Layout::Description(), vFingerprint, vMinSizes);
+		Assert::IsFalse(aEmpty.matches(vFingerprint));
+
+		SIZE szMin = {100, 50};
+		vMinSizes.push_back(szMin);
+		Layout::LayoutTemplate aTemplate(Layout::Description(), vFingerprint, vMinSizes);
+		Assert::IsTrue(aTemplate.matches(vFingerprint));
+
+		vFingerprint[1] = 8;
+		Assert::IsFalse(aTemplate.matches(vFingerprint));
+	}
+};
@@ -0,0 +1,109 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include <vector>
+
+#include "Base/DynLayout/GlobExport/messagetrace.h"
+#include "Base/DynLayout/GlobExport/replay.h"
+#include "Base/DynLayout/GlobExport/description.h"
+
+/** A trace of a window without frame and one resizing control, with its description. */
+static void InitResizeTrace(Layout::MessageTrace& aTrace)
+{
+	Layout::Description aDescription;
+	aDescription.parse("control list 1001 resize resize\n");
+	std::vector<char> vImage;
+	aDescription.toBinary(vImage);
+	aTrace.setDescription(vImage);
+
+	aTrace.setClientSize(200, 100);
+	Layout::MessageTrace::ControlEntry aControl = {1001, {10, 10, 190, 90}};
+	aTrace.addControl(aControl);
+}
+
+[TestFixture]
+ref class MessageTraceTest
+{
+public:
+	[Test]
+	void binaryRoundTrip()
+	{
+		Layout::MessageTrace aTrace;
+		aTrace.setClientSize(640, 480);
+		aTrace.setFrame(8, 30, 8, 8);
+
+		Layout::MessageTrace::ControlEntry aControl = {1001, {10, 20, 110, 220}};
+		aTrace.addControl(aControl);
+
+		Layout::MessageTrace::Event aEvent = {15, Layout::MessageTrace::EventSize, 0, {800, 600, 0, 0}};
+		aTrace.addEvent(aEvent);
+
+		std::vector<char> vDescription(12, 'd');
+		aTrace.setDescription(vDescription);
+
+		std::vector<char> vImage;
+		aTrace.toBinary(vImage);
+
+		Layout::MessageTrace aLoaded;
+		Assert::IsTrue(aLoaded.loadBinary(&vImage[0], vImage.size()));
+		Assert::IsTrue(aLoaded.getClientWidth() == 640 && aLoaded.getClientHeight() == 480);
+		Assert::IsTrue(aLoaded.getFrame(1) == 30 && aLoaded.getFrame(3) == 8);
+		Assert::IsTrue(aLoaded.getControlCount() == 1 && aLoaded.getControl(0).nId == 1001);
+		Assert::IsTrue(aLoaded.getControl(0).aiRect[3] == 220);
+		Assert::IsTrue(aLoaded.getEventCount() == 1 && aLoaded.getEvent(0).nKind == Layout::MessageTrace::EventSize);
+		Assert::IsTrue(aLoaded.getEvent(0).aiValue[1] == 600);
+		Assert::IsTrue(aLoaded.getDescription() == vDescription);
+	}
+
+	[Test]
+	void rejectTruncated()
+	{
+		Layout::MessageTrace aTrace;
+		Layout::MessageTrace::Event aEvent = {0, Layout::MessageTrace::EventSizing, 2, {0, 0, 300, 200}};
+		aTrace.addEvent(aEvent);
+
+		std::vector<char> vImage;
+		aTrace.toBinary(vImage);
+
+		Layout::MessageTrace aLoaded;
+		Assert::IsFalse(aLoaded.loadBinary(&vImage[0], vImage.size() - 1));
+		Assert::IsTrue(aLoaded.getEventCount() == 0);
+		Assert::IsFalse(aLoaded.loadBinary("DLYT", 4));
+	}
+
+	[Test]
+	void replayEndsAtRecordedLayout()
+	{
+		Layout::MessageTrace aTrace;
+		InitResizeTrace(aTrace);
+
+		// The sizing rect has no frame around the client rect, the replay window adds its own
+		Layout::MessageTrace::Event aSize = {0, Layout::MessageTrace::EventSize, SIZE_RESTORED, {300, 150, 0, 0}};
+		Layout::MessageTrace::Event aSizing = {10, Layout::MessageTrace::EventSizing, WMSZ_BOTTOMRIGHT, {100, 100, 500, 300}};
+		aTrace.addEvent(aSize);
+		aTrace.addEvent(aSizing);
+
+		std::vector<double> vLatencyUs;
+		std::vector<Layout::MessageTrace::ControlEntry> vFinal;
+		Assert::IsTrue(Layout::MessageReplayer::replay(aTrace, vLatencyUs, &vFinal));
+		Assert::IsTrue(vLatencyUs.size() == 2 && vFinal.size() == 1);
+		Assert::IsTrue(vFinal[0].nId == 1001);
+		Assert::IsTrue(vFinal[0].aiRect[0] == 10 && vFinal[0].aiRect[1] == 10);
+		Assert::IsTrue(vFinal[0].aiRect[2] == 390 && vFinal[0].aiRect[3] == 190);
+	}
+
+	[Test]
+	void replayRejectsDuplicateIds()
+	{
+		Layout::MessageTrace aTrace;
+		InitResizeTrace(aTrace);
+		Layout::MessageTrace::ControlEntry aStatic = {1001, {10, 95, 50, 100}};
+		aTrace.addControl(aStatic);
+
+		std::vector<double> vLatencyUs;
+		Assert::IsFalse(Layout::MessageReplayer::replay(aTrace, vLatencyUs));
+	}
+};
@@ -0,0 +1,110 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include "Base/DynLayout/GlobExport/manager.h"
+#include "Base/DynLayout/GlobExport/alignment.h"
+#include "Base/DynLayout/GlobExport/area.h"
+#include "Base/DynLayout/GlobExport/splitter.h"
+
+#include "testwindow.h"
+
+static Layout::Align::Slot ResizeSlot()
+{
+	return Layout::Align::Slot(Layout::Align::KindResize, 100);
+}
+
+[TestFixture]
+ref class SplitAreaTest
+{
+public:
+	[Test]
+	void nestedSplitNeedsItsChildren()
+	{
+		TestWindow window(400, 400);
+		HWND hLeft = window.addChild(1001, CRect(10, 10, 190, 390));
+		HWND hTop = window.addChild(1002, CRect(210, 10, 390, 190));
+		HWND hBottom = window.addChild(1003, CRect(210, 210, 390, 390));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			manager.addControl(hLeft, ResizeSlot(), ResizeSlot(), "left");
+			manager.addControl(hTop, ResizeSlot(), ResizeSlot(), "top");
+			manager.addControl(hBottom, ResizeSlot(), ResizeSlot(), "bottom");
+			
+			Layout::Splitter const* pOuter = manager.putSplitter(hLeft, hTop, Layout::Splitter::Vertical, Layout::Splitter::AlignRelative);
+			Layout::Splitter const* pInner = manager.putSplitter(hTop, hBottom, Layout::Splitter::Horizontal, Layout::Splitter::AlignRelative);
+			Assert::IsTrue(pOuter && pInner && pInner->getArea() != pOuter->getArea());
+			
+			// The right area is split again, it owns no controls itself
+			Layout::Area const* pRight = pInner->getArea();
+			Assert::IsTrue(pRight->getChildCount() == 2);
+			SIZE const& szUpper = pRight->getChild(0)->getMinSize();
+			SIZE const& szLower = pRight->getChild(1)->getMinSize();
+			SIZE const& szRight = pRight->getMinSize();
+			Assert::IsTrue(szRight.cy >= szUpper.cy + szLower.cy);
+			Assert::IsTrue(szRight.cx >= szUpper.cx && szRight.cx >= szLower.cx);
+			
+			Layout::Area const* pRoot = pOuter->getArea();
+			Assert::IsTrue(pRoot->getMinSize().cx >= pRoot->getChild(0)->getMinSize().cx + szRight.cx);
+			Assert::IsTrue(TestWindow::getMinTrackSize(manager).cy >= szRight.cy);
+		}
+	}
+	
+	[Test]
+	void rowNeedsAllItsChildren()
+	{
+		TestWindow window(400, 400);
+		HWND hFirst = window.addChild(1001, CRect(10, 10, 110, 390));
+		HWND hSecond = window.addChild(1002, CRect(130, 10, 230, 390));
+		HWND hThird = window.addChild(1003, CRect(250, 10, 390, 390));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			manager.addControl(hFirst, ResizeSlot(), ResizeSlot(), "first");
+			manager.addControl(hSecond, ResizeSlot(), ResizeSlot(), "second");
+			manager.addControl(hThird, ResizeSlot(), ResizeSlot(), "third");
+			
+			Layout::Splitter const* pFirst = manager.putSplitter(hFirst, hSecond, Layout::Splitter::Vertical, Layout::Splitter::AlignRelative);
+			Layout::Splitter const* pSecond = manager.putSplitter(hSecond, hThird, Layout::Splitter::Vertical, Layout::Splitter::AlignRelative);
+			Assert::IsTrue(pFirst && pSecond && pFirst->getArea() == pSecond->getArea());
+			
+			// The second split joins the first one, all three columns are children of the root
+			Layout::Area const* pRow = pFirst->getArea();
+			Assert::IsTrue(pRow->getChildCount() == 3 && pRow->getSplitterCount() == 2);
+			LONG lSum = 0;
+			for(size_t nChild = 0; nChild < pRow->getChildCount(); ++nChild)
+			{
+				SIZE const& szChild = pRow->getChild(nChild)->getMinSize();
+				Assert::IsTrue(pRow->getMinSize().cy >= szChild.cy);
+				lSum += szChild.cx;
+			}
+			Assert::IsTrue(pRow->getMinSize().cx >= lSum);
+			Assert::IsTrue(TestWindow::getMinTrackSize(manager).cx >= lSum);
+		}
+	}
+	
+	[Test]
+	void hiddenControlLeavesMinSize()
+	{
+		TestWindow window(400, 400);
+		HWND hLeft = window.addChild(1001, CRect(10, 10, 190, 390));
+		HWND hRight = window.addChild(1002, CRect(210, 10, 390, 390));
+		{
+			Layout::Manager manager(window.m_hWnd);
+			manager.addControl(hLeft, ResizeSlot(), ResizeSlot(), "left");
+			manager.addControl(hRight, Layout::Align::Slot(Layout::Align::KindResize, 300), ResizeSlot(), "right");
+			Layout::Splitter const* pSplitter = manager.putSplitter(hLeft, hRight, Layout::Splitter::Vertical, Layout::Splitter::AlignRelative);
+			Layout::Area const* pRight = pSplitter->getArea()->getChild(1);
+			LONG lShown = pRight->getMinSize().cx;
+			
+			Assert::IsTrue(manager.setControlVisible(hRight, false));
+			Assert::IsTrue((::GetWindowLong(hRight, GWL_STYLE) & WS_VISIBLE) == 0);
+			Assert::IsTrue(pRight->getMinSize().cx < lShown);
+			
+			Assert::IsTrue(manager.setControlVisible((UINT) 1002, true));
+			Assert::IsTrue((::GetWindowLong(hRight, GWL_STYLE) & WS_VISIBLE) != 0);
+			Assert::IsTrue(pRight->getMinSize().cx == lShown);
+		}
+	}
+};
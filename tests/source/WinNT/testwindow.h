@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Base/DynLayout/GlobExport/manager.h"
+
+/**
+ * A hidden borderless window with static controls, so that window, client and layout coords are the same.
+ * The manager must be destroyed before the window.
+ */
+class TestWindow
+{
+public:
+	TestWindow(int iWidth, int iHeight)
+	{
+		m_hWnd = ::CreateWindowEx(0, "STATIC", "", WS_POPUP, 0, 0, iWidth, iHeight, NULL, NULL, AfxGetInstanceHandle(), NULL);
+	}
+	
+	~TestWindow()
+	{
+		::DestroyWindow(m_hWnd);
+	}
+	
+	HWND addChild(UINT nID, CRect const& rect)
+	{
+		return ::CreateWindowEx(0, "STATIC", "", WS_CHILD|WS_VISIBLE, rect.left, rect.top, rect.Width(), rect.Height(), m_hWnd, (HMENU) (UINT_PTR) nID, AfxGetInstanceHandle(), NULL);
+	}
+	
+	/** Resizes the window and runs the layout pass. */
+	void resize(Layout::Manager& manager, int iWidth, int iHeight)
+	{
+		::SetWindowPos(m_hWnd, NULL, 0, 0, iWidth, iHeight, SWP_NOMOVE|SWP_NOZORDER|SWP_NOACTIVATE);
+		manager.update();
+	}
+	
+	CRect getChildRect(HWND hChild) const
+	{
+		CRect rect;
+		::GetWindowRect(hChild, &rect);
+		::MapWindowPoints(NULL, m_hWnd, (LPPOINT) &rect, 2);
+		return rect;
+	}
+	
+	static CSize getMinTrackSize(Layout::Manager& manager)
+	{
+		MINMAXINFO info;
+		::ZeroMemory(&info, sizeof(info));
+		info.ptMaxTrackSize.x = info.ptMaxTrackSize.y = 10000;
+		manager.getMinMaxInfo(&info);
+		return CSize(info.ptMinTrackSize.x, info.ptMinTrackSize.y);
+	}
+	
+	HWND m_hWnd;
+};
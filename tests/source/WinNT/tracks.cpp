@@ -0,0 +1,65 @@
+using namespace NUnit::Framework;
+
+#define _AFXDLL
+#include <afxwin.h>
+#undef _AFXDLL
+
+#include "Base/DynLayout/GlobExport/tracks.h"
+
+[TestFixture]
+ref class TracksTest
+{
+public:
+	[Test]
+	void minSizeSumsFixedAutoAndGaps()
+	{
+		Layout::Tracks aTracks(5);
+		aTracks.add(Layout::Tracks::KindFixed, 40);
+		aTracks.add(Layout::Tracks::KindAuto);
+		aTracks.add(Layout::Tracks::KindProportional, 1);
+
+		aTracks.fitContent(1, 1, 30);
+		aTracks.fitContent(1, 1, 20);
+		Assert::IsTrue(aTracks.getMinSize() == 40 + 30 + 2 * 5);
+
+		// Spanning controls and other kinds do not size a track
+		aTracks.fitContent(1, 2, 100);
+		aTracks.fitContent(0, 1, 100);
+		Assert::IsTrue(aTracks.getMinSize() == 80);
+
+		aTracks.resetContent();
+		Assert::IsTrue(aTracks.getMinSize() == 50);
+	}
+
+	[Test]
+	void distributesRemainingSpaceByWeight()
+	{
+		Layout::Tracks aTracks;
+		aTracks.add(Layout::Tracks::KindFixed, 10);
+		aTracks.add(Layout::Tracks::KindProportional, 1);
+		aTracks.add(Layout::Tracks::KindProportional, 2);
+
+		int iStart = 0, iEnd = 0;
+		Assert::IsFalse(aTracks.getSpan(0, 1, iStart, iEnd));
+
+		aTracks.layout(100, 110);
+		Assert::IsTrue(aTracks.getSpan(0, 1, iStart, iEnd) && iStart == 100 && iEnd == 110);
+		Assert::IsTrue(aTracks.getSpan(1, 1, iStart, iEnd) && iStart == 110 && iEnd == 143);
+		Assert::IsTrue(aTracks.getSpan(2, 1, iStart, iEnd) && iStart == 143 && iEnd == 210);
+		Assert::IsTrue(aTracks.getSpan(1, 2, iStart, iEnd) && iStart == 110 && iEnd == 210);
+		Assert::IsFalse(aTracks.getSpan(2, 2, iStart, iEnd));
+	}
+
+	[Test]
+	void sharesAddUpExactly()
+	{
+		Layout::Tracks aTracks(1);
+		for(int i = 0; i < 7; ++i)
+			aTracks.add(Layout::Tracks::KindProportional, 1);
+
+		// 6 gaps, 94 pixels for 7 tracks of equal weight
+		aTracks.layout(0, 100);
+		int iStart = 0, iEnd = 0;
+		Assert::IsTrue(aTracks.getSpan(0, 7, iStart, iEnd) && iStart == 0 && iEnd == 100);
+	}
+};